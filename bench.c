@@ -0,0 +1,414 @@
+// file: bench.c
+// Benchmarks of grid initialization, the step engines and the frame
+// renderer over grid sizes, densities and thread counts. Each case runs
+// in a child process of its own, so its peak memory is measured alone,
+// and prints one CSV line.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers
+
+#include <fcntl.h> // open
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h> // getrusage
+#include <sys/wait.h> // waitpid
+#include <time.h> // clock_gettime
+#include <unistd.h> // fork, dup, sysconf
+
+#include "display.h"
+#include "grid.h"
+#include "kernel.h"
+#include "wildfire.h"
+
+#define BENCH_INIT 0   // grid_populate
+#define BENCH_STEP 1   // one engine stepping cycles
+#define BENCH_RENDER 2 // the frame renderer drawing cycles
+
+#define MAX_LIST 16 // values in a list option
+
+#define DEFAULT_WORK 200000000.0 // cell updates to aim for in a case
+#define DEFAULT_SEED 41
+#define MAX_CYCLES 1000 // cycles of a case with a tiny grid
+#define MIN_CYCLES 2 // cycles of a case with a huge grid
+#define MAX_RENDER 2048 // larger grids do not fit on a terminal
+
+#define BENCH_BURNING 0.10 // pBurning of every case
+#define BENCH_CATCH 0.50 // pCatch of every case
+#define BENCH_NEIGHBOR 0.25 // pNeighbor of every case
+
+static const char *benchNames[] = { "init", "step", "render" };
+
+static const char *engineNames[] = { "dense", "sparse", "packed", "tiled", "counted" }; // by WildfireEngine
+
+/// One benchmark to run.
+
+typedef struct {
+    int bench;     // BENCH_INIT, BENCH_STEP or BENCH_RENDER
+    int engine;    // engine stepped by BENCH_STEP
+    size_t size;   // width and height of the grid
+    int density;   // percent of the cells holding a tree
+    int threads;   // threads stepping the grid
+} Case;
+
+static double work = DEFAULT_WORK; // cell updates to aim for in a case
+
+static unsigned long seed = DEFAULT_SEED; // seed of the random numbers
+
+static RowKernel kernel = NULL; // row kernel of the dense and tiled engines
+
+/// Prints usage information to stderr and quits.
+
+static void help() {
+    fprintf( stderr, "usage: bench [options]\n" );
+    fprintf( stderr, "Prints one CSV line per case: benchmark,engine,kernel,width,height,density,\n" );
+    fprintf( stderr, "threads,cycles,cells,seconds,cells_per_s,ns_per_cell,peak_rss_kb\n" );
+    fprintf( stderr, " -H # View benchmark options and quit.\n" );
+    fprintf( stderr, " -bLIST # benchmarks among init, step and render. default: all.\n" );
+    fprintf( stderr, " -sLIST # grid sizes. default: 64,256,1024,4096,16384.\n" );
+    fprintf( stderr, " -dLIST # densities in percent. default: 30,60,90.\n" );
+    fprintf( stderr, " -tLIST # thread counts. default: 1 and the number of processors.\n" );
+    fprintf( stderr, " -eLIST # engines among dense, sparse, packed, tiled and counted. default: all.\n" );
+    fprintf( stderr, " -kNAME # row kernel: scalar, sse or avx2. default: fastest supported.\n" );
+    fprintf( stderr, " -wN # cell updates to aim for in each case. default: 2e8.\n" );
+    fprintf( stderr, " -SN # seed of the random numbers. default: 41.\n" );
+    fprintf( stderr, " -q # quick run: sizes 64,256,1024, density 60.\n" );
+    fprintf( stderr, "LIST is comma separated, e.g. -s1024,4096 -t1,8.\n" );
+    exit( EXIT_SUCCESS );
+}
+
+/// Reads the monotonic clock.
+/// @return seconds since an arbitrary point in the past
+
+static double seconds() {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// Parses a comma separated list of positive integers.
+/// @return the number of values, or 0 if the list is bad
+
+static int numbers( const char *text, long *values ) {
+    int n = 0;
+    for (;;) {
+        char *end;
+        long v = strtol( text, &end, 10 );
+        if ( end == text || v < 1 || n == MAX_LIST ) {
+            return 0;
+        }
+        values[n++] = v;
+        if ( *end == '\0' ) {
+            return n;
+        }
+        if ( *end != ',' ) {
+            return 0;
+        }
+        text = end + 1;
+    }
+}
+
+/// Parses a comma separated list of names.
+/// @return a bit per name found in names, or 0 if a name is unknown
+
+static unsigned names( char *text, const char *const *known, int count ) {
+    unsigned set = 0;
+    for ( char *word = strtok( text, "," ); word != NULL; word = strtok( NULL, "," ) ) {
+        int i = 0;
+        while ( i < count && strcmp( word, known[i] ) != 0 ) {
+            i++;
+        }
+        if ( i == count ) {
+            return 0;
+        }
+        set |= 1u << i;
+    }
+    return set;
+}
+
+/// Number of cycles of a case on a grid of the given area.
+
+static long cyclesFor( size_t area ) {
+    double n = work / area;
+    return n < MIN_CYCLES ? MIN_CYCLES : n > MAX_CYCLES ? MAX_CYCLES : (long) n;
+}
+
+/// Fills the grid of a case with trees at random.
+
+static void populate( Grid *g, int density ) {
+    size_t area = g->width * g->height;
+    long trees = (long)( area * ( density / 100.0 ) + 0.5 );
+    long fires = (long)( trees * BENCH_BURNING + 0.5 );
+    grid_populate( g, trees - fires, fires, seed );
+}
+
+/// Creates the simulation of a case (see wildfire.h).
+
+static Wildfire *simulate( const Case *c, WildfireEngine engine, int threads ) {
+    WildfireConfig cfg;
+    wildfire_defaults( &cfg );
+    cfg.width = c->size;
+    cfg.height = c->size;
+    cfg.pCatch = BENCH_CATCH;
+    cfg.density = c->density / 100.0f;
+    cfg.pBurning = BENCH_BURNING;
+    cfg.pNeighbor = BENCH_NEIGHBOR;
+    cfg.seed = seed;
+    cfg.engine = engine;
+    cfg.threads = threads;
+    cfg.kernel = kernel;
+    return wildfire_create( &cfg );
+}
+
+/// Runs one case and writes its CSV line. Called in a child process.
+/// @return 0 on success, -1 if memory or threads could not be obtained
+
+static int runCase( const Case *c, FILE *out ) {
+
+    size_t size = c->size;
+    size_t area = size * size;
+    long cycles = cyclesFor( area );
+    const char *kernelName = "-";
+    double elapsed = 0;
+
+    if ( c->bench == BENCH_INIT ) {
+        double started = seconds();
+        for ( long i = 0; i < cycles; i++ ) {
+            Grid *grid = grid_create( size, size );
+            if ( grid == NULL ) {
+                return -1;
+            }
+            populate( grid, c->density );
+            grid_destroy( grid );
+        }
+        elapsed = seconds() - started;
+
+    } else if ( c->bench == BENCH_STEP ) {
+        Wildfire *sim = simulate( c, (WildfireEngine) c->engine, c->threads );
+        if ( sim == NULL ) {
+            return -1;
+        }
+        kernelName = c->engine == WILDFIRE_SPARSE ? "front"
+                   : c->engine == WILDFIRE_PACKED ? "swar"
+                   : c->engine == WILDFIRE_COUNTED ? "counts" : kernel_name( kernel );
+
+        // every cycle is stepped, even once the fires are out
+        double started = seconds();
+        for ( long i = 0; i < cycles; i++ ) {
+            if ( wildfire_step( sim ) != 0 ) {
+                return -1;
+            }
+        }
+        elapsed = seconds() - started;
+        wildfire_destroy( sim );
+
+    } else {
+        // cycles are stepped by the dense engine, only their drawing is timed
+        Wildfire *sim = simulate( c, WILDFIRE_DENSE, 1 );
+        char *line = malloc( size + 1 );
+        Frame *frame = frame_create( (int) size, (int) size );
+        if ( sim == NULL || line == NULL || frame == NULL ) {
+            return -1;
+        }
+
+        // the renderer writes to stdout; the results go to the saved descriptor
+        int devnull = open( "/dev/null", O_WRONLY );
+        if ( devnull < 0 || dup2( devnull, STDOUT_FILENO ) < 0 ) {
+            return -1;
+        }
+
+        for ( long i = 0; i < cycles; i++ ) {
+            const Grid *grid = wildfire_grid( sim );
+            double started = seconds();
+            for ( size_t r = 0; r < size; r++ ) {
+                const cell_t *row = grid_row( grid, r );
+                for ( size_t j = 0; j < size; j++ ) {
+                    line[j] = cell_char[row[j]];
+                }
+                frame_row( frame, (int) r, line );
+            }
+            frame_flush( frame );
+            elapsed += seconds() - started;
+            if ( wildfire_step( sim ) != 0 ) {
+                return -1;
+            }
+        }
+        kernelName = "frame";
+    }
+
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+
+    double cells = (double) area * cycles;
+    fprintf( out, "%s,%s,%s,%zu,%zu,%.2f,%d,%ld,%.0f,%.6f,%.4g,%.4g,%ld\n",
+             benchNames[c->bench], c->bench == BENCH_STEP ? engineNames[c->engine] : "-",
+             kernelName, size, size, c->density / 100.0, c->threads, cycles, cells, elapsed,
+             elapsed > 0 ? cells / elapsed : 0.0, cells > 0 ? elapsed * 1e9 / cells : 0.0,
+             usage.ru_maxrss );
+    fflush( out );
+    return 0;
+}
+
+/// Runs a case in a child process.
+/// @return 0 on success, -1 if the case failed
+
+static int forkCase( const Case *c ) {
+
+    fflush( stdout );
+    pid_t pid = fork();
+    if ( pid < 0 ) {
+        return -1;
+    }
+    if ( pid == 0 ) {
+        FILE *out = fdopen( dup( STDOUT_FILENO ), "w" );
+        _exit( out != NULL && runCase( c, out ) == 0 ? EXIT_SUCCESS : EXIT_FAILURE );
+    }
+
+    int status;
+    if ( waitpid( pid, &status, 0 ) != pid || !WIFEXITED( status )
+         || WEXITSTATUS( status ) != EXIT_SUCCESS ) {
+        return -1;
+    }
+    return 0;
+}
+
+/// Parses the options and runs every case they select.
+/// @param argc length of argv
+/// @param argv array of command strings
+
+int main( int argc, char *argv[] ) {
+
+    long sizes[MAX_LIST] = { 64, 256, 1024, 4096, 16384 };
+    long densities[MAX_LIST] = { 30, 60, 90 };
+    long threadCounts[MAX_LIST] = { 1 };
+    int sizeCount = 5;
+    int densityCount = 3;
+    int threadCount = 1;
+    unsigned benches = 07;
+    unsigned engines = 037;
+
+    long processors = sysconf( _SC_NPROCESSORS_ONLN );
+    if ( processors > 1 ) {
+        threadCounts[threadCount++] = processors;
+    }
+
+    int c;
+    while ( ( c = getopt( argc, argv, "Hb:d:e:k:qs:t:w:S:" ) ) != -1 ) {
+        switch ( c ) {
+        case 'H':
+            help();
+            break;
+        case 'b':
+            if ( ( benches = names( optarg, benchNames, 3 ) ) == 0 ) {
+                fprintf( stderr, "(-bLIST) benchmarks must be init, step or render.\n" );
+                help();
+            }
+            break;
+        case 'd':
+            if ( ( densityCount = numbers( optarg, densities ) ) == 0 ) {
+                fprintf( stderr, "(-dLIST) densities must be integers in [1...100].\n" );
+                help();
+            }
+            break;
+        case 'e':
+            if ( ( engines = names( optarg, engineNames, 5 ) ) == 0 ) {
+                fprintf( stderr, "(-eLIST) engines must be dense, sparse, packed, tiled or counted.\n" );
+                help();
+            }
+            break;
+        case 'k':
+            if ( ( kernel = kernel_select( optarg ) ) == NULL ) {
+                fprintf( stderr, "(-kNAME) kernel must be scalar, sse or avx2 and supported by this processor.\n" );
+                help();
+            }
+            break;
+        case 'q':
+            sizes[0] = 64;
+            sizes[1] = 256;
+            sizes[2] = 1024;
+            sizeCount = 3;
+            densities[0] = 60;
+            densityCount = 1;
+            break;
+        case 's':
+            if ( ( sizeCount = numbers( optarg, sizes ) ) == 0 ) {
+                fprintf( stderr, "(-sLIST) sizes must be positive integers.\n" );
+                help();
+            }
+            break;
+        case 't':
+            if ( ( threadCount = numbers( optarg, threadCounts ) ) == 0 ) {
+                fprintf( stderr, "(-tLIST) thread counts must be positive integers.\n" );
+                help();
+            }
+            break;
+        case 'w':
+            work = strtod( optarg, NULL );
+            if ( !( work > 0 ) ) {
+                fprintf( stderr, "(-wN) cell updates per case must be positive.\n" );
+                help();
+            }
+            break;
+        case 'S':
+            seed = strtoul( optarg, NULL, 10 );
+            break;
+        default:
+            help();
+            break;
+        }
+    }
+
+    if ( kernel == NULL ) {
+        kernel = kernel_select( NULL );
+    }
+
+    printf( "benchmark,engine,kernel,width,height,density,threads,cycles,cells,seconds,"
+            "cells_per_s,ns_per_cell,peak_rss_kb\n" );
+
+    int failed = 0;
+    for ( int s = 0; s < sizeCount; s++ ) {
+        for ( int d = 0; d < densityCount; d++ ) {
+            Case base = { .size = (size_t) sizes[s], .density = (int) densities[d], .threads = 1 };
+            if ( densities[d] > 100 ) {
+                continue;
+            }
+
+            if ( benches & ( 1u << BENCH_INIT ) ) {
+                Case k = base;
+                k.bench = BENCH_INIT;
+                failed |= forkCase( &k );
+            }
+
+            for ( int e = 0; e < 5 && ( benches & ( 1u << BENCH_STEP ) ); e++ ) {
+                for ( int t = 0; t < threadCount && ( engines & ( 1u << e ) ); t++ ) {
+                    if ( ( e == WILDFIRE_SPARSE || e == WILDFIRE_COUNTED ) && threadCounts[t] > 1 ) {
+                        continue; // the front and the counts are stepped by one thread
+                    }
+                    Case k = base;
+                    k.bench = BENCH_STEP;
+                    k.engine = e;
+                    k.threads = (int) threadCounts[t];
+                    if ( (size_t) k.threads > k.size ) {
+                        continue;
+                    }
+                    failed |= forkCase( &k );
+                }
+            }
+
+            if ( ( benches & ( 1u << BENCH_RENDER ) ) && base.size <= MAX_RENDER ) {
+                Case k = base;
+                k.bench = BENCH_RENDER;
+                failed |= forkCase( &k );
+            }
+        }
+    }
+
+    if ( failed ) {
+        fprintf( stderr, "some cases ran out of memory or threads and were left out.\n" );
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+// file: checkpoint.c
+// Binary snapshots of a running simulation, written and reopened with mmap.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers; ftruncate, fsync
+
+#include <errno.h>
+#include <fcntl.h> // open
+#include <stdio.h> // rename, snprintf
+#include <stdlib.h>
+#include <string.h> // memcpy, memcmp
+#include <sys/mman.h> // mmap, msync, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // close, pread, sysconf
+
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC "WILDFIRE" ///< first 8 bytes of every checkpoint
+#define CHECKPOINT_VERSION 2        ///< layout of the header and the cells; 2 since grids have a halo of 2
+#define CHECKPOINT_ORDER 0x01020304 ///< reads back differently on another byte order
+
+/// First bytes of a checkpoint file. The grid image follows at offset.
+
+typedef struct {
+    char magic[8];     // CHECKPOINT_MAGIC, not terminated
+    uint32_t version;  // CHECKPOINT_VERSION
+    uint32_t order;    // CHECKPOINT_ORDER
+    uint64_t offset;   // position of the grid image; a multiple of the page size
+    uint64_t stride;   // row stride of the grid image
+    uint64_t bytes;    // size of the grid image
+    Snapshot state;    // everything but the grid
+} Header;
+
+/// Returns the offset of the grid image: the header rounded up to a page.
+
+static uint64_t imageOffset() {
+    uint64_t page = (uint64_t) sysconf( _SC_PAGESIZE );
+    return ( sizeof (Header) + page - 1 ) / page * page;
+}
+
+/// Writes a checkpoint into path.tmp and renames it over path.
+
+int checkpoint_save( const char *path, const Snapshot *s, const Grid *g ) {
+
+    size_t length = strlen( path ) + sizeof ".tmp";
+    char *tmp = malloc( length );
+    if ( tmp == NULL ) {
+        return -1;
+    }
+    snprintf( tmp, length, "%s.tmp", path );
+
+    Header h = { .version = CHECKPOINT_VERSION, .order = CHECKPOINT_ORDER,
+                 .offset = imageOffset(), .stride = g->stride, .bytes = g->bytes,
+                 .state = *s };
+    memcpy( h.magic, CHECKPOINT_MAGIC, sizeof h.magic );
+    size_t total = h.offset + g->bytes;
+
+    int fd = open( tmp, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+    if ( fd < 0 ) {
+        free( tmp );
+        return -1;
+    }
+
+    int status = -1;
+    if ( ftruncate( fd, (off_t) total ) == 0 ) {
+        unsigned char *p = mmap( NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        if ( p != MAP_FAILED ) {
+            memcpy( p, &h, sizeof h );
+            memcpy( p + h.offset, g->base, g->bytes );
+            status = msync( p, total, MS_SYNC );
+            munmap( p, total );
+        }
+    }
+    if ( status == 0 ) {
+        status = fsync( fd );
+    }
+
+    int saved = errno;
+    close( fd );
+    if ( status == 0 ) {
+        status = rename( tmp, path );
+        saved = errno;
+    }
+    if ( status != 0 ) {
+        unlink( tmp );
+    }
+    free( tmp );
+    errno = saved;
+    return status;
+}
+
+/// Reopens a checkpoint, mapping its grid image from the file.
+
+Grid *checkpoint_load( const char *path, Snapshot *s ) {
+
+    int fd = open( path, O_RDONLY );
+    if ( fd < 0 ) {
+        return NULL;
+    }
+
+    Header h;
+    struct stat st;
+    Grid *g = NULL;
+
+    if ( pread( fd, &h, sizeof h, 0 ) == (ssize_t) sizeof h
+         && memcmp( h.magic, CHECKPOINT_MAGIC, sizeof h.magic ) == 0
+         && h.version == CHECKPOINT_VERSION && h.order == CHECKPOINT_ORDER
+         && h.offset == imageOffset()
+         && fstat( fd, &st ) == 0 && h.offset <= (uint64_t) st.st_size
+         && h.bytes <= (uint64_t) st.st_size - h.offset
+         && h.state.width <= SIZE_MAX && h.state.height <= SIZE_MAX ) {
+        g = grid_map( fd, h.offset, (size_t) h.state.width, (size_t) h.state.height );
+        if ( g != NULL && ( g->stride != h.stride || g->bytes != h.bytes ) ) {
+            grid_destroy( g ); // saved with another layout
+            g = NULL;
+        }
+    }
+
+    close( fd ); // the mapping holds its own reference to the file
+    if ( g != NULL ) {
+        *s = h.state;
+    }
+    return g;
+}
@@ -0,0 +1,68 @@
+/*
+ * File:    checkpoint.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Binary snapshots of a running simulation. A checkpoint file is a
+ * header holding the parameters, the counters and the random stream
+ * position, padded to a page boundary, followed by the image of the
+ * grid exactly as it lies in memory: one byte per cell, rows padded to
+ * the grid stride, halo included. Random draws are a function of the
+ * seed, the cycle and the cell (see rng.h), so the seed and the number
+ * of cycles stepped are the whole state of the generator.
+ *      A checkpoint is written into a temporary file through a shared
+ * mapping, flushed to disk and renamed over the old one, so a run that
+ * is killed mid-write still leaves the previous checkpoint intact. It
+ * is restored without copying: the grid image is mapped privately from
+ * the file and pages are read only as the simulation touches them.
+ *
+ */
+
+#ifndef WILDFIRE_CHECKPOINT_H
+#define WILDFIRE_CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "grid.h"
+
+/// The state of a simulation besides its grid.
+///
+typedef struct {
+    uint64_t width;       ///< number of columns in the grid
+    uint64_t height;      ///< number of rows in the grid
+    uint64_t seed;        ///< seed of the random number streams
+    uint64_t step;        ///< cycles stepped; the stream of the next cycle
+    int64_t cycle;        ///< cycles left to run
+    int64_t cChanges;     ///< cumulative number of changes
+    int64_t totalTrees;   ///< trees not burned out
+    int64_t fireTrees;    ///< burning trees
+    int64_t livingTrees;  ///< living trees
+    int64_t spaces;       ///< empty cells
+    int64_t initialTrees; ///< trees at cycle 0
+    float pCatch;         ///< probability of a tree catching fire
+    float density;        ///< proportion of cells holding a tree at cycle 0
+    float pBurning;       ///< proportion of trees burning at cycle 0
+    float pNeighbor;      ///< proportion of burning neighbors needed to spread
+} Snapshot;
+
+/// Writes a checkpoint, replacing any file at path only once the new
+/// one is complete and on disk.
+///
+/// @param path: name of the checkpoint file
+/// @param s: state of the simulation; width and height must match g
+/// @param g: grid of the current cycle
+/// @return 0 on success, -1 with errno set if the file could not be written
+///
+int checkpoint_save( const char *path, const Snapshot *s, const Grid *g );
+
+/// Reopens a checkpoint. The grid is mapped from the file, not read.
+///
+/// @param path: name of the checkpoint file
+/// @param s: receives the state of the simulation
+/// @return the grid of the saved cycle, to be released with grid_destroy,
+///         or NULL if the file could not be opened or is not a checkpoint
+///
+Grid *checkpoint_load( const char *path, Snapshot *s );
+
+#endif
@@ -0,0 +1,266 @@
+// file: counted.c
+// Incremental stepping from neighbor counts kept up to date as trees catch
+// fire and burn out.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#include <stdlib.h>
+
+#include "counted.h"
+#include "prof.h"
+#include "rng.h"
+
+#define STAGES 4 ///< cycles a tree burns: KINDLED or BURN0 to BURN2
+#define LISTED 0x80 ///< bit of a tree count set while the cell is a candidate
+
+/// A list of cells, stored as offsets from the first cell of the grid.
+
+typedef struct {
+    size_t *cells;   // the offsets
+    size_t count;    // number of offsets
+    size_t capacity; // room in cells
+} List;
+
+/// Neighbor counts of one cell. Both are read and written together, so
+/// they share a cache line.
+
+typedef struct {
+    unsigned char trees; // tree neighbors, plus LISTED
+    unsigned char fires; // burning neighbors
+} Count;
+
+/// Neighbor counts of every cell of a grid, halo included, with the lists
+/// that let a step visit only the cells that change.
+
+struct Counted {
+    Count *base;             // allocation of counts
+    Count *counts;           // counts of each cell, at the offsets of the grid
+    ptrdiff_t around[KERNEL_MAX_NEIGHBORS]; // offsets of the neighbors
+    int neighbors;           // number of offsets in around
+    size_t width;            // number of cells in a row
+    size_t stride;           // distance between rows
+    List candidates;         // living trees, mostly with burning neighbors
+    List caught;             // trees that catch fire this step
+    List burning[STAGES];    // burning trees, by cycle of burning out mod STAGES
+    size_t now;              // cycles stepped
+};
+
+/// Makes room for at least need offsets in a list.
+/// @return 0 on success, -1 if memory could not be obtained
+
+static int reserve( List *l, size_t need ) {
+    if ( need <= l->capacity ) {
+        return 0;
+    }
+    size_t room = l->capacity ? l->capacity : 256;
+    while ( room < need ) {
+        room *= 2;
+    }
+    size_t *p = realloc( l->cells, room * sizeof (size_t) );
+    if ( p == NULL ) {
+        return -1;
+    }
+    l->cells = p;
+    l->capacity = room;
+    return 0;
+}
+
+/// Appends an offset to a list.
+/// @return 0 on success, -1 if memory could not be obtained
+
+static int append( List *l, size_t off ) {
+    if ( reserve( l, l->count + 1 ) != 0 ) {
+        return -1;
+    }
+    l->cells[l->count++] = off;
+    return 0;
+}
+
+/// Fills the offsets of the neighbors of a cell in a grid of a stride.
+/// @return the number of neighbors
+
+static int offsets( Neighborhood hood, ptrdiff_t s, ptrdiff_t *around ) {
+    int n = 0;
+    int reach = hood == NEIGHBORHOOD_RADIUS2 ? 2 : 1;
+    for ( int dr = -reach; dr <= reach; dr++ ) {
+        for ( int dc = -reach; dc <= reach; dc++ ) {
+            if ( ( dr == 0 && dc == 0 )
+                 || ( hood == NEIGHBORHOOD_VON_NEUMANN && dr != 0 && dc != 0 ) ) {
+                continue;
+            }
+            around[n++] = dr * s + dc;
+        }
+    }
+    return n;
+}
+
+/// Lists a living tree as a candidate, unless it already is one.
+/// @return 0 on success, -1 if memory could not be obtained
+
+static int enlist( Counted *c, size_t off ) {
+    if ( c->counts[off].trees & LISTED ) {
+        return 0;
+    }
+    c->counts[off].trees |= LISTED;
+    return append( &c->candidates, off );
+}
+
+/// Creates the counts of a grid.
+
+Counted *counted_create( const Grid *g, Neighborhood hood ) {
+
+    Counted *c = calloc( 1, sizeof (Counted) );
+    if ( c == NULL ) {
+        return NULL;
+    }
+    c->base = calloc( g->bytes, sizeof (Count) );
+    if ( c->base == NULL ) {
+        free( c );
+        return NULL;
+    }
+    c->counts = c->base + ( g->cells - g->base ); // same layout as the grid
+    c->neighbors = offsets( hood, (ptrdiff_t) g->stride, c->around );
+    c->width = g->width;
+    c->stride = g->stride;
+
+    for ( size_t r = 0; r < g->height; r++ ) {
+        for ( size_t col = 0; col < g->width; col++ ) {
+            size_t off = r * g->stride + col;
+            cell_t cell = g->cells[off];
+            if ( !( cell & CELL_TREE ) ) {
+                continue;
+            }
+            for ( int k = 0; k < c->neighbors; k++ ) {
+                Count *n = &c->counts[off + c->around[k]];
+                n->trees++;
+                n->fires += ( cell & CELL_FIRE ) != 0;
+            }
+            if ( cell & CELL_FIRE ) {
+                // KINDLED burns four more cycles, BURN2 one
+                size_t stage = (size_t)( cell - CELL_KINDLED ) >> 5;
+                if ( append( &c->burning[( STAGES - stage ) % STAGES], off ) != 0 ) {
+                    counted_destroy( c );
+                    return NULL;
+                }
+            }
+        }
+    }
+
+    for ( size_t r = 0; r < g->height; r++ ) {
+        for ( size_t col = 0; col < g->width; col++ ) {
+            size_t off = r * g->stride + col;
+            if ( g->cells[off] == CELL_LIVING && c->counts[off].fires > 0 && enlist( c, off ) != 0 ) {
+                counted_destroy( c );
+                return NULL;
+            }
+        }
+    }
+    return c;
+}
+
+/// Releases counts. NULL is ignored.
+
+void counted_destroy( Counted *c ) {
+    if ( c == NULL ) {
+        return;
+    }
+    free( c->base );
+    free( c->candidates.cells );
+    free( c->caught.cells );
+    for ( int s = 0; s < STAGES; s++ ) {
+        free( c->burning[s].cells );
+    }
+    free( c );
+}
+
+/// Computes the next cycle of a grid in place. The candidates are drawn for
+/// first, from the counts of the current cycle, dropping the ones that caught
+/// fire or whose burning neighbors burned out since they were listed. Then
+/// the trees due to burn out do, and the trees drawn catch fire, each
+/// changing the counts of its neighbors and listing the living ones.
+
+int counted_step( Counted *c, Grid *g, const SpreadRule *rule, uint64_t key,
+                  uint64_t limit, Summary *summary, long *ignited, long *burnedOut ) {
+
+    cell_t *cells = g->cells;
+    size_t draws = 0; // counted for the profile only
+    size_t listed = c->candidates.count;
+
+    size_t kept = 0;
+    c->caught.count = 0;
+    for ( size_t i = 0; i < listed; i++ ) {
+        size_t off = c->candidates.cells[i];
+        Count *n = &c->counts[off];
+        if ( cells[off] != CELL_LIVING || n->fires == 0 ) {
+            n->trees &= (unsigned char) ~LISTED;
+            continue;
+        }
+        c->candidates.cells[kept++] = off;
+        if ( n->fires >= rule->need[n->trees & ~LISTED] ) {
+            size_t r = off / c->stride;
+            draws++;
+            if ( rng_draw( key, (uint64_t) r * c->width + ( off - r * c->stride ) ) < limit
+                 && append( &c->caught, off ) != 0 ) {
+                return -1;
+            }
+        }
+    }
+    c->candidates.count = kept;
+
+    c->now++;
+    List *out = &c->burning[c->now % STAGES];
+    for ( size_t i = 0; i < out->count; i++ ) {
+        size_t off = out->cells[i];
+        cells[off] = CELL_BURNT;
+        for ( int k = 0; k < c->neighbors; k++ ) {
+            Count *n = &c->counts[off + c->around[k]];
+            n->trees--;
+            n->fires--;
+        }
+    }
+    *burnedOut = (long) out->count;
+    out->count = 0;
+
+    // the trees catching fire now are BURN0 and burn out STAGES - 1 cycles on
+    List *in = &c->burning[( c->now + STAGES - 1 ) % STAGES];
+    if ( reserve( in, in->count + c->caught.count ) != 0 ) {
+        return -1;
+    }
+    for ( size_t i = 0; i < c->caught.count; i++ ) {
+        size_t off = c->caught.cells[i];
+        cells[off] = CELL_BURN0;
+        in->cells[in->count++] = off;
+        if ( summary != NULL ) {
+            size_t r = off / c->stride;
+            summary_ignite( summary, r, off - r * c->stride );
+        }
+        for ( int k = 0; k < c->neighbors; k++ ) {
+            size_t n = off + c->around[k];
+            c->counts[n].fires++;
+            if ( cells[n] == CELL_LIVING && enlist( c, n ) != 0 ) {
+                return -1;
+            }
+        }
+    }
+    *ignited = (long) c->caught.count;
+
+    // the trees that caught fire are among the candidates listed
+    size_t evaluated = listed + (size_t) *burnedOut;
+    size_t area = g->width * g->height;
+    PROF_COUNT( PROF_RNG_DRAWS, draws );
+    PROF_COUNT( PROF_EVALUATED, evaluated );
+    PROF_COUNT( PROF_SKIPPED, area > evaluated ? area - evaluated : 0 );
+    return 0;
+}
+
+/// Writes the burn cycle of every burning tree into a grid.
+
+void counted_sync( const Counted *c, Grid *g ) {
+    for ( size_t left = 1; left <= STAGES; left++ ) {
+        const List *l = &c->burning[( c->now + left ) % STAGES];
+        cell_t state = (cell_t)( CELL_KINDLED + ( ( STAGES - left ) << 5 ) );
+        for ( size_t i = 0; i < l->count; i++ ) {
+            g->cells[l->cells[i]] = state;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * File:    counted.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Incremental stepping. Every cell keeps the number of trees and of
+ * burning trees among its neighbors, and the counts are only changed
+ * around the trees that catch fire or burn out, so they never have to
+ * be summed again. The living trees next to a burning tree are kept in
+ * a list, and a cycle draws for just those; the burning trees are kept
+ * by the cycle in which they burn out, so a cycle touches only the ones
+ * that do. A step costs O(changes x neighbors + trees next to the fire)
+ * however large the grid and however long the fire burns.
+ *      The grid is stepped in place. Trees that catch fire are written as
+ * CELL_BURN0 and keep that state while they burn; counted_sync writes
+ * the burn cycle of every burning tree when the grid is to be read. The
+ * result is identical to a dense update: every decision reads the counts
+ * as they were at the start of the cycle and every draw is keyed by cell
+ * index.
+ *
+ */
+
+#ifndef WILDFIRE_COUNTED_H
+#define WILDFIRE_COUNTED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "kernel.h"
+#include "summary.h"
+
+/// Opaque neighbor counts and lists of a grid.
+///
+typedef struct Counted Counted;
+
+/// Creates the counts of a grid, by summing the neighbors of every cell
+/// once. The grid must not be stepped by anything else from then on.
+///
+/// @param g: the grid
+/// @param hood: cells counted as neighbors
+/// @return the counts, or NULL if memory could not be obtained
+///
+Counted *counted_create( const Grid *g, Neighborhood hood );
+
+/// Releases counts. NULL is ignored.
+///
+/// @param c: the counts
+///
+void counted_destroy( Counted *c );
+
+/// Computes the next cycle of a grid in place, from its counts.
+///
+/// @param c: counts of the grid; updated to the next cycle
+/// @param g: grid to be stepped
+/// @param rule: neighbor counts that spread fire
+/// @param key: key of the random stream of this cycle
+/// @param limit: a draw under this limit catches fire
+/// @param summary: told of every tree that catches fire; NULL for none
+/// @param ignited: receives the number of trees that caught fire
+/// @param burnedOut: receives the number of trees that burned out
+/// @return 0 on success, -1 if memory could not be obtained
+///
+int counted_step( Counted *c, Grid *g, const SpreadRule *rule, uint64_t key,
+                  uint64_t limit, Summary *summary, long *ignited, long *burnedOut );
+
+/// Writes the burn cycle of every burning tree into a grid, which is then
+/// exactly the current cycle.
+///
+/// @param c: counts of the grid
+/// @param g: the grid
+///
+void counted_sync( const Counted *c, Grid *g );
+
+#endif
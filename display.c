@@ -3,6 +3,9 @@
  *
  * Revision History: 
  *    $Log: display.c,v $
+ *    Added frame renderer that draws only changed cells and flushes
+ *    once per frame.
+ *
  *    Revision 1.3  2014/11/22 16:45:32  csci243
  *    Removed BAD pause function.
  *
@@ -15,6 +18,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "display.h"
 
@@ -41,3 +46,145 @@ void set_cur_pos( int rCursor, int cCursor) {
     printf( "\033[%d;%dH", rCursor, cCursor );
 } // set_cur_pos
 
+
+#define FRAME_GAP 6 // unchanged characters rewritten rather than moving the cursor
+
+/// Characters on the screen and the output being collected.
+
+struct Frame {
+    int rows;      // rows drawn
+    int cols;      // columns drawn
+    char *shown;   // characters on the screen; 0 where unknown
+    char *buf;     // output not yet written
+    size_t len;    // bytes in buf
+    size_t cap;    // room in buf
+    int curRow;    // row of the cursor, or -1 if unknown
+    int curCol;    // column of the cursor
+};
+
+//
+// Name:    reserve
+//
+static int reserve( Frame *f, size_t more ) {
+    if ( f->len + more <= f->cap ) {
+        return 0;
+    }
+    size_t cap = f->cap * 2 + more;
+    char *p = realloc( f->buf, cap );
+    if ( p == NULL ) {
+        return -1;
+    }
+    f->buf = p;
+    f->cap = cap;
+    return 0;
+} // reserve
+
+//
+// Name:    move
+//
+static void move( Frame *f, int row, int col ) {
+    if ( reserve( f, 32 ) == 0 ) {
+        f->len += sprintf( f->buf + f->len, "\033[%d;%dH", row + 1, col + 1 );
+        f->curRow = row;
+        f->curCol = col;
+    }
+} // move
+
+//
+// Name:    frame_create
+//
+Frame *frame_create( int rows, int cols ) {
+    Frame *f = calloc( 1, sizeof (Frame) );
+    if ( f == NULL ) {
+        return NULL;
+    }
+    f->rows = rows;
+    f->cols = cols;
+    f->shown = calloc( (size_t) rows * cols, 1 );
+    f->cap = (size_t) cols * 2 + 64;
+    f->buf = malloc( f->cap );
+    f->curRow = -1;
+    if ( f->shown == NULL || f->buf == NULL ) {
+        frame_destroy( f );
+        return NULL;
+    }
+    return f;
+} // frame_create
+
+//
+// Name:    frame_destroy
+//
+void frame_destroy( Frame *f ) {
+    if ( f == NULL ) {
+        return;
+    }
+    free( f->shown );
+    free( f->buf );
+    free( f );
+} // frame_destroy
+
+//
+// Name:    frame_clear
+//
+void frame_clear( Frame *f ) {
+    memset( f->shown, 0, (size_t) f->rows * f->cols );
+    if ( reserve( f, 8 ) == 0 ) {
+        memcpy( f->buf + f->len, "\033[2J", 4 );
+        f->len += 4;
+    }
+    f->curRow = -1;
+} // frame_clear
+
+//
+// Name:    frame_row
+//
+void frame_row( Frame *f, int row, const char *text ) {
+
+    char *shown = f->shown + (size_t) row * f->cols;
+
+    for ( int c = 0; c < f->cols; c++ ) {
+        if ( text[c] == shown[c] ) {
+            continue;
+        }
+        if ( reserve( f, (size_t)( f->cols - c ) + FRAME_GAP + 32 ) != 0 ) {
+            return;
+        }
+        int gap = c - f->curCol;
+        if ( f->curRow == row && gap >= 0 && gap <= FRAME_GAP ) {
+            // cheaper to rewrite the unchanged characters than to move
+            memcpy( f->buf + f->len, text + f->curCol, gap );
+            f->len += gap;
+        } else {
+            move( f, row, c );
+        }
+        f->buf[f->len++] = text[c];
+        shown[c] = text[c];
+        f->curCol = c + 1;
+    }
+} // frame_row
+
+//
+// Name:    frame_text
+//
+void frame_text( Frame *f, int row, const char *text ) {
+    size_t n = strlen( text );
+    move( f, row, 0 );
+    if ( reserve( f, n + 4 ) == 0 ) {
+        memcpy( f->buf + f->len, text, n );
+        f->len += n;
+        memcpy( f->buf + f->len, "\033[K", 3 ); // erase the rest of the line
+        f->len += 3;
+    }
+    f->curRow = -1;
+} // frame_text
+
+//
+// Name:    frame_flush
+//
+size_t frame_flush( Frame *f ) {
+    size_t n = f->len;
+    fwrite( f->buf, 1, n, stdout );
+    fflush( stdout );
+    f->len = 0;
+    return n;
+} // frame_flush
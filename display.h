@@ -32,6 +32,8 @@
 #ifndef RITCSFIGURES_DISPLAY_H
 #define RITCSFIGURES_DISPLAY_H
 
+#include <stddef.h>
+
 
 /// Clear the terminal window of all characters.
 /// @post: The terminal window display is modified and cleared.
@@ -57,4 +59,58 @@ void put( char character );
 /// 
 void set_cur_pos( int rCursor, int cCursor);
 
+/// A frame renderer. It remembers what is on the screen, so drawing a
+/// frame emits cursor moves and characters only for the cells that changed,
+/// with nearby changes on a row coalesced into one run. Output is collected
+/// in one buffer and written and flushed once per frame.
+/// Frame coordinates start at row 0, column 0 in the top-left corner.
+///
+typedef struct Frame Frame;
+
+/// Create a frame renderer for an area of the terminal.
+///
+/// @param rows: number of rows drawn
+/// @param cols: number of columns drawn
+/// @return the renderer, or NULL if memory could not be obtained
+///
+Frame *frame_create( int rows, int cols );
+
+/// Release a frame renderer. NULL is ignored.
+///
+/// @param f: the renderer
+///
+void frame_destroy( Frame *f );
+
+/// Clear the terminal window and forget what was on it, so the next
+/// frame is drawn in full.
+///
+/// @param f: the renderer
+///
+void frame_clear( Frame *f );
+
+/// Draw one row of the frame. Only characters that differ from what is
+/// on the screen are written.
+///
+/// @param f: the renderer
+/// @param row: the row, from 0
+/// @param text: the characters of the row; as many as the frame has columns
+///
+void frame_row( Frame *f, int row, const char *text );
+
+/// Write a line of text at a row, replacing the rest of that line.
+/// Rows below the frame may be used for status lines.
+///
+/// @param f: the renderer
+/// @param row: the row, from 0
+/// @param text: the text, without a newline
+///
+void frame_text( Frame *f, int row, const char *text );
+
+/// Write everything drawn since the last flush to the terminal at once.
+///
+/// @param f: the renderer
+/// @return the number of bytes written
+///
+size_t frame_flush( Frame *f );
+
 #endif
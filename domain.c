@@ -0,0 +1,444 @@
+// file: domain.c
+// A simulation split into subdomains stepped by worker processes, which
+// exchange the edges of their subdomains and reduce their counts through
+// shared memory.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers; MAP_ANONYMOUS
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h> // fflush
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h> // clock_gettime
+#include <unistd.h>
+
+#include "domain.h"
+#include "rng.h"
+
+#define LINE 64 ///< bytes in a cache line
+
+/// Counts of one worker for one cycle.
+
+typedef struct {
+    long ignited;   // trees of the subdomain that caught fire
+    long burnedOut; // trees of the subdomain that burned out
+} Counts;
+
+/// Head of the shared memory. The counts, then the mailboxes, follow it.
+
+typedef struct {
+    pthread_barrier_t line;  // workers wait here at the end of each cycle
+    int failed;              // 1 if a worker could not get its memory
+    WildfireCounters result; // counters after the last cycle, from worker 0
+    double elapsed;          // seconds worker 0 spent stepping
+} Head;
+
+/// How the grid is split and where everything is in the shared memory.
+
+typedef struct {
+    size_t width;       // number of columns in the grid
+    size_t height;      // number of rows in the grid
+    size_t reach;       // depth of the halo: rows and columns a neighborhood reaches
+    int across;         // subdomains in a row of them
+    int down;           // subdomains in a column of them
+    int processes;      // across times down
+    uint64_t seed;      // seed of the random number streams
+    SpreadRule rule;    // neighbor sums that spread fire
+    RowKernel kernel;   // row kernel specialized to the rule
+    uint64_t catchLimit; // draws below it catch fire
+    unsigned char *shared; // the shared memory
+    size_t bytes;       // size of the shared memory
+    size_t counts;      // offset of the counts: [2][processes]
+    size_t *mailbox;    // offset of the mailboxes of each worker
+} Plan;
+
+/// A worker's subdomain and the grids of its cycles.
+
+typedef struct {
+    int rank;         // the worker, from 0, row of subdomains by row
+    size_t r0;        // first row of the subdomain in the grid
+    size_t c0;        // first column of the subdomain in the grid
+    size_t rows;      // rows of the subdomain
+    size_t cols;      // columns of the subdomain
+    Grid *grid;       // current cycle, halo included
+    Grid *next;       // next cycle, halo included
+    size_t *candidates; // columns of trees that may catch fire
+} Sub;
+
+/// Rounds a size up to a whole number of cache lines.
+
+static size_t lines( size_t bytes ) {
+    return ( bytes + LINE - 1 ) / LINE * LINE;
+}
+
+/// Returns the first row or column of part i of a length cut in n parts.
+
+static size_t cut( size_t length, int n, int i ) {
+    return length * (size_t) i / (size_t) n;
+}
+
+/// Places the subdomain of a worker.
+
+static void locate( const Plan *p, int rank, Sub *s ) {
+    int i = rank / p->across;
+    int j = rank % p->across;
+    s->rank = rank;
+    s->r0 = cut( p->height, p->down, i );
+    s->rows = cut( p->height, p->down, i + 1 ) - s->r0;
+    s->c0 = cut( p->width, p->across, j );
+    s->cols = cut( p->width, p->across, j + 1 ) - s->c0;
+}
+
+/// Shapes the subdomains: of all the ways to write processes as down
+/// times across with subdomains at least reach deep, the one with the
+/// shortest edges per subdomain.
+/// @return 0, or -1 if there is none
+
+static int shape( Plan *p, int processes ) {
+    double best = 0;
+    p->down = 0;
+    for ( int down = 1; down <= processes; down++ ) {
+        int across = processes / down;
+        if ( down * across != processes
+             || p->height / (size_t) down < p->reach || p->width / (size_t) across < p->reach ) {
+            continue;
+        }
+        double edges = (double) p->height / down + (double) p->width / across;
+        if ( p->down == 0 || edges < best ) {
+            best = edges;
+            p->down = down;
+            p->across = across;
+        }
+    }
+    p->processes = processes;
+    return p->down > 0 ? 0 : -1;
+}
+
+/// Returns the size of one half of a worker's mailbox: its top and bottom
+/// rows, then its left and right columns, each reach deep.
+
+static size_t half( const Plan *p, const Sub *s ) {
+    return 2 * p->reach * s->cols + 2 * p->reach * s->rows;
+}
+
+/// Returns the half of a worker's mailbox for a cycle.
+
+static unsigned char *box( const Plan *p, int rank, long step ) {
+    Sub s;
+    locate( p, rank, &s );
+    return p->shared + p->mailbox[rank] + (size_t)( step & 1 ) * half( p, &s );
+}
+
+/// Returns the counts of a worker for a cycle.
+
+static Counts *slot( const Plan *p, int rank, long step ) {
+    Counts *counts = (Counts *)( p->shared + p->counts );
+    return &counts[(size_t)( step & 1 ) * (size_t) p->processes + (size_t) rank];
+}
+
+/// Publishes the edges of a worker's subdomain in a cycle.
+
+static void publish( const Plan *p, const Sub *s, const Grid *g, long step ) {
+    size_t h = p->reach;
+    unsigned char *m = box( p, s->rank, step );
+    for ( size_t i = 0; i < h; i++ ) {
+        memcpy( m, grid_row( g, h + i ) + h, s->cols );
+        m += s->cols;
+    }
+    for ( size_t i = 0; i < h; i++ ) {
+        memcpy( m, grid_row( g, s->rows + i ) + h, s->cols );
+        m += s->cols;
+    }
+    for ( size_t i = 0; i < s->rows; i++ ) {
+        memcpy( m, grid_row( g, h + i ) + h, h );
+        m += h;
+    }
+    for ( size_t i = 0; i < s->rows; i++ ) {
+        memcpy( m, grid_row( g, h + i ) + s->cols, h );
+        m += h;
+    }
+}
+
+/// Copies into the halo of a worker's grid the edges its neighbor at
+/// rows di and columns dj of subdomains away (each -1, 0 or 1) published
+/// in a cycle. The halo beyond the grid is left empty.
+
+static void collect( const Plan *p, const Sub *s, Grid *g, int di, int dj, long step ) {
+    int i = s->rank / p->across + di;
+    int j = s->rank % p->across + dj;
+    if ( i < 0 || i >= p->down || j < 0 || j >= p->across ) {
+        return;
+    }
+    Sub n;
+    locate( p, i * p->across + j, &n );
+    size_t h = p->reach;
+    const unsigned char *top = box( p, n.rank, step );
+    const unsigned char *bottom = top + h * n.cols;
+    const unsigned char *left = bottom + h * n.cols;
+    const unsigned char *right = left + h * n.rows;
+
+    if ( di != 0 ) {
+        // rows of the neighbor's edge facing us, or the end of them at a corner
+        const unsigned char *edge = di < 0 ? bottom : top;
+        size_t from = dj < 0 ? n.cols - h : 0; // first column taken
+        size_t count = dj == 0 ? s->cols : h;
+        size_t at = dj < 0 ? 0 : dj > 0 ? h + s->cols : h; // first halo column
+        size_t r = di < 0 ? 0 : h + s->rows; // first halo row
+        for ( size_t k = 0; k < h; k++ ) {
+            memcpy( grid_row( g, r + k ) + at, edge + k * n.cols + from, count );
+        }
+        return;
+    }
+    const unsigned char *edge = dj < 0 ? right : left;
+    size_t at = dj < 0 ? 0 : h + s->cols;
+    for ( size_t k = 0; k < s->rows; k++ ) {
+        memcpy( grid_row( g, h + k ) + at, edge + k * h, h );
+    }
+}
+
+/// Steps a worker's subdomain one cycle, from grid into next.
+
+static void advance( const Plan *p, Sub *s, long step, Counts *out ) {
+    uint64_t key = rng_key( p->seed, (uint64_t) step );
+    size_t h = p->reach;
+    out->ignited = 0;
+    out->burnedOut = 0;
+    for ( size_t i = 0; i < s->rows; i++ ) {
+        size_t count;
+        size_t r = s->r0 + i; // row in the grid
+        cell_t *row = grid_row( s->next, h + i ) + h;
+        out->burnedOut += p->kernel( grid_row( s->grid, h + i ) + h, s->grid->stride, row,
+                                     s->cols, &p->rule, s->candidates, &count );
+        for ( size_t k = 0; k < count; k++ ) {
+            size_t j = s->candidates[k];
+            if ( rng_draw( key, (uint64_t) r * p->width + s->c0 + j ) < p->catchLimit ) {
+                row[j] = CELL_BURN0;
+                out->ignited++;
+            }
+        }
+    }
+}
+
+/// Reads the monotonic clock in seconds.
+
+static double seconds() {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// Body of a worker process. It takes its subdomain of cycle 0, then
+/// each cycle fills its halo from its neighbors, steps, publishes its
+/// edges and counts, and waits for all the others at the barrier. Every
+/// worker adds up the same counts and stops at the same cycle.
+/// @param g cycle 0, the whole grid
+/// @param c counters of cycle 0
+/// @param cycles most cycles stepped
+/// @return exit status of the process
+
+static int work( const Plan *p, int rank, const Grid *g, WildfireCounters c, long cycles ) {
+
+    Head *head = (Head *) p->shared;
+    Sub s;
+    locate( p, rank, &s );
+    size_t h = p->reach;
+    s.grid = grid_create( s.cols + 2 * h, s.rows + 2 * h );
+    s.next = grid_create( s.cols + 2 * h, s.rows + 2 * h );
+    s.candidates = malloc( s.cols * sizeof (size_t) );
+    if ( s.grid == NULL || s.next == NULL || s.candidates == NULL ) {
+        __atomic_store_n( &head->failed, 1, __ATOMIC_RELAXED );
+    } else {
+        for ( size_t i = 0; i < s.rows; i++ ) {
+            memcpy( grid_row( s.grid, h + i ) + h, grid_row( g, s.r0 + i ) + s.c0, s.cols );
+        }
+        publish( p, &s, s.grid, c.step );
+    }
+    pthread_barrier_wait( &head->line );
+    if ( __atomic_load_n( &head->failed, __ATOMIC_RELAXED ) ) {
+        return EXIT_FAILURE;
+    }
+    double started = seconds();
+
+    while ( c.fireTrees > 0 && cycles > 0 ) {
+        for ( int di = -1; di <= 1; di++ ) {
+            for ( int dj = -1; dj <= 1; dj++ ) {
+                if ( di != 0 || dj != 0 ) {
+                    collect( p, &s, s.grid, di, dj, c.step );
+                }
+            }
+        }
+        advance( p, &s, c.step, slot( p, rank, c.step ) );
+        publish( p, &s, s.next, c.step + 1 );
+        pthread_barrier_wait( &head->line );
+
+        // the global reduction, in the same order in every worker
+        long ignited = 0;
+        long burnedOut = 0;
+        for ( int k = 0; k < p->processes; k++ ) {
+            ignited += slot( p, k, c.step )->ignited;
+            burnedOut += slot( p, k, c.step )->burnedOut;
+        }
+        c.changes = ignited + burnedOut;
+        c.fireTrees += ignited - burnedOut;
+        c.livingTrees -= ignited;
+        c.totalTrees -= burnedOut;
+        c.cChanges += c.changes;
+        c.step++;
+        cycles--;
+
+        Grid *tmp = s.grid;
+        s.grid = s.next;
+        s.next = tmp;
+    }
+
+    if ( rank == 0 ) {
+        head->result = c;
+        head->elapsed = seconds() - started;
+    }
+    return EXIT_SUCCESS;
+}
+
+/// Stops the workers still running after one failed, and waits for all.
+
+static void reap( pid_t *pids, int count ) {
+    for ( int k = 0; k < count; k++ ) {
+        if ( pids[k] > 0 ) {
+            kill( pids[k], SIGKILL );
+        }
+    }
+    for ( int k = 0; k < count; k++ ) {
+        if ( pids[k] > 0 ) {
+            waitpid( pids[k], NULL, 0 );
+        }
+    }
+}
+
+/// Lays out the shared memory, maps it and sets up the barrier.
+/// @return 0, or -1 if memory could not be obtained; nothing is mapped then
+
+static int share( Plan *p ) {
+    p->mailbox = malloc( (size_t) p->processes * sizeof (size_t) );
+    if ( p->mailbox == NULL ) {
+        return -1;
+    }
+    p->counts = lines( sizeof (Head) );
+    size_t at = p->counts + lines( 2 * (size_t) p->processes * sizeof (Counts) );
+    for ( int k = 0; k < p->processes; k++ ) {
+        Sub s;
+        locate( p, k, &s );
+        p->mailbox[k] = at;
+        at += lines( 2 * half( p, &s ) );
+    }
+    p->bytes = at;
+    p->shared = mmap( NULL, p->bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if ( p->shared == MAP_FAILED ) {
+        p->shared = NULL;
+        return -1;
+    }
+
+    Head *head = (Head *) p->shared;
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init( &attr );
+    pthread_barrierattr_setpshared( &attr, PTHREAD_PROCESS_SHARED );
+    int failed = pthread_barrier_init( &head->line, &attr, (unsigned) p->processes ) != 0;
+    pthread_barrierattr_destroy( &attr );
+    if ( failed ) {
+        munmap( p->shared, p->bytes );
+        p->shared = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/// Runs a simulation on worker processes.
+
+int domain_run( const WildfireConfig *cfg, int processes, long cycles, WildfireCounters *c,
+                double *elapsed ) {
+
+    Plan p;
+    memset( &p, 0, sizeof p );
+    p.width = cfg->width;
+    p.height = cfg->height;
+    p.reach = cfg->neighborhood == NEIGHBORHOOD_RADIUS2 ? 2 : 1;
+    p.seed = cfg->seed;
+    if ( cfg->threshold > 0 ) {
+        kernel_threshold( &p.rule, cfg->neighborhood, cfg->threshold );
+    } else {
+        kernel_rule( &p.rule, cfg->neighborhood, cfg->pNeighbor );
+    }
+    p.kernel = kernel_specialize( cfg->kernel != NULL ? cfg->kernel : kernel_select( NULL ), &p.rule );
+    p.catchLimit = rng_limit( cfg->pCatch );
+    if ( processes < 1 || shape( &p, processes ) != 0 ) {
+        grid_destroy( cfg->landscape );
+        return -1;
+    }
+
+    // cycle 0, as one process would build it
+    WildfireConfig one = *cfg;
+    one.engine = WILDFIRE_DENSE;
+    one.threads = 1;
+    one.timeBlock = 1;
+    one.summary = 0;
+    Wildfire *w = wildfire_create( &one );
+    pid_t *pids = calloc( (size_t) processes, sizeof (pid_t) );
+    int failed = w == NULL || pids == NULL || share( &p ) != 0;
+
+    int started = 0;
+    if ( !failed ) {
+        const Grid *g = wildfire_grid( w );
+        wildfire_query( w, c );
+        fflush( NULL ); // nothing buffered is written twice
+        while ( started < processes ) {
+            pid_t pid = fork();
+            if ( pid == 0 ) {
+                _exit( work( &p, started, g, *c, cycles ) );
+            }
+            if ( pid < 0 ) {
+                break;
+            }
+            pids[started++] = pid;
+        }
+        failed = started < processes;
+    }
+    wildfire_destroy( w ); // the workers have their own copies
+
+    // a worker that fails leaves the others waiting at the barrier
+    int left = failed ? 0 : started;
+    while ( left > 0 ) {
+        int status;
+        pid_t pid = wait( &status );
+        if ( pid < 0 ) {
+            failed = 1;
+            break;
+        }
+        for ( int k = 0; k < started; k++ ) {
+            if ( pids[k] == pid ) {
+                pids[k] = 0;
+                left--;
+            }
+        }
+        if ( !WIFEXITED( status ) || WEXITSTATUS( status ) != EXIT_SUCCESS ) {
+            failed = 1;
+            break;
+        }
+    }
+    reap( pids, started );
+
+    if ( !failed ) {
+        *c = ( (Head *) p.shared )->result;
+        *elapsed = ( (Head *) p.shared )->elapsed;
+    }
+    if ( p.shared != NULL ) {
+        pthread_barrier_destroy( &( (Head *) p.shared )->line );
+        munmap( p.shared, p.bytes );
+    }
+    free( p.mailbox );
+    free( pids );
+    return failed ? -1 : 0;
+}
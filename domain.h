@@ -0,0 +1,52 @@
+/*
+ * File:    domain.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Domain decomposition over worker processes on one host. The grid
+ * is cut into a rectangle of rows by columns of subdomains, one per
+ * worker process, shaped to keep the edges between them short. Each
+ * worker holds only its own subdomain, surrounded by a halo as deep as
+ * the neighborhood reaches, and steps it with the row kernels of the
+ * dense engine; draws are keyed by the cell's index in the whole grid,
+ * so a run gives the same cycles and counters as in one process.
+ *      Workers share nothing but a block of shared memory mapped before
+ * they are forked. After each cycle a worker publishes the edges of its
+ * subdomain into a mailbox of its own, and before the next one it copies
+ * the edges of its eight neighbors into its halo. Its counts of trees
+ * that caught fire and burned out go to a slot of its own. Mailboxes and
+ * slots have two halves, for even and odd cycles, so one barrier per
+ * cycle separates all writes from all reads. After the barrier every
+ * worker adds up the slots in the same order and holds the same global
+ * counters, and so decides on its own, and the same as all the others,
+ * whether the fires are out and the run is over.
+ *
+ */
+
+#ifndef WILDFIRE_DOMAIN_H
+#define WILDFIRE_DOMAIN_H
+
+#include "wildfire.h"
+
+/// Runs a simulation on worker processes until the fires are out or a
+/// number of cycles is stepped. Cycle 0 is built in the calling process,
+/// as wildfire_create builds it, and handed to the workers as they are
+/// forked; the dense engine with one thread steps every subdomain.
+///
+/// @param cfg: what is simulated; engine, threads, time blocking and
+///             summary are ignored
+/// @param processes: number of worker processes, at least 1
+/// @param cycles: most cycles stepped
+/// @param c: receives the counters after the last cycle
+/// @param elapsed: receives the seconds spent stepping, from the first
+///                 cycle to the last, forking and cycle 0 not included
+/// @return 0 on success, -1 if the grid is too small to give every
+///         process a subdomain as deep as the neighborhood reaches, if
+///         memory, shared memory or processes could not be obtained, or
+///         if a worker failed
+///
+int domain_run( const WildfireConfig *cfg, int processes, long cycles, WildfireCounters *c,
+                double *elapsed );
+
+#endif
@@ -0,0 +1,321 @@
+// file: ensemble.c
+// Monte Carlo ensembles of whole simulations on a pool of worker threads.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ensemble.h"
+#include "grid.h"
+#include "wildfire.h"
+
+/// One combination of parameters, in percent.
+
+typedef struct {
+    int burning;
+    int catching;
+    int density;
+    int neighbor;
+} Point;
+
+/// What one run produced.
+
+typedef struct {
+    double burned;  // fraction of the trees at cycle 0 that burned out
+    long cycles;    // cycles stepped
+    int out;        // 1 if the fires went out
+    int percolated; // 1 if burned trees connect the top and bottom rows
+} Outcome;
+
+/// Work shared by all workers. Job j runs replicate j % replicates of
+/// point j / replicates and stores its outcome in outcomes[j].
+
+typedef struct {
+    const EnsembleConfig *cfg;
+    Point *points;
+    size_t jobs;
+    Outcome *outcomes;
+    size_t next;          // next job to hand out
+    int failed;           // 1 if a worker ran out of memory
+    pthread_mutex_t lock; // guards next and failed
+} Pool;
+
+/// A worker thread and the simulation and buffers it reuses for every run.
+
+typedef struct {
+    pthread_t thread;
+    Pool *pool;
+    Wildfire *sim;       // steps every run of the worker, on one thread
+    Grid *marks;         // copy of the last cycle, marked by the percolation search
+    size_t *stack;       // cells still to visit in the percolation search
+    size_t stackCapacity;
+} Worker;
+
+/// Parses a range given as "N", "LO:HI" or "LO:HI:STEP".
+
+int ensemble_range( const char *text, Range *range ) {
+
+    char *end;
+    range->lo = (int) strtol( text, &end, 10 );
+    range->hi = range->lo;
+    range->step = 1;
+
+    if ( end == text ) {
+        return -1;
+    }
+    if ( *end == ':' ) {
+        text = end + 1;
+        range->hi = (int) strtol( text, &end, 10 );
+        if ( end == text ) {
+            return -1;
+        }
+        if ( *end == ':' ) {
+            text = end + 1;
+            range->step = (int) strtol( text, &end, 10 );
+            if ( end == text ) {
+                return -1;
+            }
+        }
+    }
+
+    return ( *end == '\0' && range->lo <= range->hi && range->step > 0 ) ? 0 : -1;
+}
+
+/// Number of values in a range.
+
+static int values( const Range *r ) {
+    return ( r->hi - r->lo ) / r->step + 1;
+}
+
+/// Returns 1 if the burned trees of a grid form an 8-connected path from
+/// the top row to the bottom row. Visited cells are marked in the grid,
+/// which is discarded afterwards.
+/// @return 1 if they do, 0 if they do not, -1 if memory ran out
+
+static int percolates( Worker *w, Grid *g ) {
+
+    const ptrdiff_t s = (ptrdiff_t) g->stride;
+    const ptrdiff_t around[8] = { -s - 1, -s, -s + 1, -1, 1, s - 1, s, s + 1 };
+    const size_t bottom = ( g->height - 1 ) * g->stride; // first offset of the last row
+
+    size_t depth = 0;
+    cell_t *cells = g->cells;
+
+    for ( size_t c = 0; c < g->width; c++ ) {
+        cell_t *start = cells + c;
+        if ( ( *start & CELL_FIRE ) == 0 && *start != CELL_BURNT ) {
+            continue;
+        }
+        *start |= CELL_MARK;
+        depth = 0;
+        w->stack[depth++] = c;
+        while ( depth > 0 ) {
+            size_t off = w->stack[--depth];
+            if ( off >= bottom ) {
+                return 1;
+            }
+            if ( depth + 8 > w->stackCapacity ) {
+                size_t room = w->stackCapacity * 2;
+                size_t *p = realloc( w->stack, room * sizeof (size_t) );
+                if ( p == NULL ) {
+                    return -1;
+                }
+                w->stack = p;
+                w->stackCapacity = room;
+            }
+            for ( int k = 0; k < 8; k++ ) {
+                cell_t *n = cells + off + around[k];
+                if ( ( *n & CELL_MARK ) == 0 && ( ( *n & CELL_FIRE ) || *n == CELL_BURNT ) ) {
+                    *n |= CELL_MARK;
+                    w->stack[depth++] = (size_t)( n - cells );
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/// Runs one simulation to the end, exactly as a headless single run with
+/// the same parameters and seed would: the worker's simulation is started
+/// over in the grids it already has and stepped by the dense engine.
+/// @return 0 on success, -1 if memory ran out
+
+static int runOnce( Worker *w, const Point *p, unsigned long seed, Outcome *o ) {
+
+    const EnsembleConfig *cfg = w->pool->cfg;
+    WildfireCounters c;
+
+    wildfire_configure( w->sim, (float) p->catching / 100, (float) p->neighbor / 100 );
+    if ( wildfire_reset( w->sim, (float) p->density / 100, (float) p->burning / 100, seed ) != 0
+         || wildfire_step_n( w->sim, cfg->maxCycles ) < 0 ) {
+        return -1;
+    }
+    wildfire_query( w->sim, &c );
+
+    grid_copy( w->marks, wildfire_grid( w->sim ) );
+    int spans = percolates( w, w->marks );
+    if ( spans < 0 ) {
+        return -1;
+    }
+
+    o->burned = c.initialTrees > 0 ? (double)( c.initialTrees - c.totalTrees ) / c.initialTrees : 0.0;
+    o->cycles = c.step;
+    o->out = c.fireTrees == 0;
+    o->percolated = spans;
+    return 0;
+}
+
+/// Body of a worker thread: takes jobs until there are none left.
+
+static void *work( void *arg ) {
+
+    Worker *w = arg;
+    Pool *pool = w->pool;
+    int replicates = pool->cfg->replicates;
+
+    for (;;) {
+        pthread_mutex_lock( &pool->lock );
+        size_t job = pool->next++;
+        int stop = pool->failed;
+        pthread_mutex_unlock( &pool->lock );
+
+        if ( job >= pool->jobs || stop ) {
+            return NULL;
+        }
+
+        const Point *p = &pool->points[job / replicates];
+        unsigned long seed = pool->cfg->seed + job % replicates;
+        if ( runOnce( w, p, seed, &pool->outcomes[job] ) != 0 ) {
+            pthread_mutex_lock( &pool->lock );
+            pool->failed = 1;
+            pthread_mutex_unlock( &pool->lock );
+            return NULL;
+        }
+    }
+}
+
+/// Allocates the buffers of a worker.
+/// @return 0 on success, -1 if memory could not be obtained
+
+static int hire( Worker *w, Pool *pool ) {
+    const EnsembleConfig *cfg = pool->cfg;
+    WildfireConfig sim;
+    wildfire_defaults( &sim );
+    sim.width = cfg->width;
+    sim.height = cfg->height;
+    sim.engine = WILDFIRE_DENSE;
+    sim.threads = 1;
+    sim.kernel = cfg->kernel;
+    sim.neighborhood = cfg->hood;
+    sim.threshold = cfg->threshold;
+    w->pool = pool;
+    w->sim = wildfire_create( &sim ); // cycle 0 is placed again by every run
+    w->marks = grid_create( cfg->width, cfg->height );
+    w->stackCapacity = cfg->width + 8;
+    w->stack = malloc( w->stackCapacity * sizeof (size_t) );
+    return ( w->sim && w->marks && w->stack ) ? 0 : -1;
+}
+
+/// Releases the buffers of a worker.
+
+static void dismiss( Worker *w ) {
+    wildfire_destroy( w->sim );
+    grid_destroy( w->marks );
+    free( w->stack );
+}
+
+/// Writes the statistics of every point, in point order.
+
+static void report( const Pool *pool, size_t points, FILE *out ) {
+
+    int n = pool->cfg->replicates;
+
+    fprintf( out, "pBurning,pCatch,density,pNeighbor,runs,burned_mean,burned_var,"
+                  "cycles_mean,cycles_var,out_fraction,percolation\n" );
+
+    for ( size_t i = 0; i < points; i++ ) {
+        const Point *p = &pool->points[i];
+        const Outcome *o = &pool->outcomes[i * n];
+
+        // Welford's running mean and variance
+        double burnedMean = 0, burnedM2 = 0, cyclesMean = 0, cyclesM2 = 0;
+        int extinguished = 0, percolated = 0;
+        for ( int k = 0; k < n; k++ ) {
+            double d = o[k].burned - burnedMean;
+            burnedMean += d / ( k + 1 );
+            burnedM2 += d * ( o[k].burned - burnedMean );
+            d = o[k].cycles - cyclesMean;
+            cyclesMean += d / ( k + 1 );
+            cyclesM2 += d * ( o[k].cycles - cyclesMean );
+            extinguished += o[k].out;
+            percolated += o[k].percolated;
+        }
+
+        fprintf( out, "%.2f,%.2f,%.2f,%.2f,%d,%.6f,%.6g,%.3f,%.6g,%.4f,%.4f\n",
+                 p->burning / 100.0, p->catching / 100.0, p->density / 100.0,
+                 p->neighbor / 100.0, n, burnedMean, n > 1 ? burnedM2 / ( n - 1 ) : 0.0,
+                 cyclesMean, n > 1 ? cyclesM2 / ( n - 1 ) : 0.0,
+                 (double) extinguished / n, (double) percolated / n );
+    }
+}
+
+/// Runs an ensemble and writes one CSV line per parameter point.
+
+int ensemble_run( const EnsembleConfig *cfg, FILE *out ) {
+
+    size_t points = (size_t) values( &cfg->burning ) * values( &cfg->catching )
+                  * values( &cfg->density ) * values( &cfg->neighbor );
+
+    Pool pool = { .cfg = cfg, .jobs = points * cfg->replicates };
+    pool.points = malloc( points * sizeof (Point) );
+    pool.outcomes = malloc( pool.jobs * sizeof (Outcome) );
+    Worker *workers = calloc( cfg->workers, sizeof (Worker) );
+    if ( pool.points == NULL || pool.outcomes == NULL || workers == NULL ) {
+        free( pool.points );
+        free( pool.outcomes );
+        free( workers );
+        return -1;
+    }
+    pthread_mutex_init( &pool.lock, NULL );
+
+    size_t i = 0;
+    for ( int b = cfg->burning.lo; b <= cfg->burning.hi; b += cfg->burning.step ) {
+        for ( int c = cfg->catching.lo; c <= cfg->catching.hi; c += cfg->catching.step ) {
+            for ( int d = cfg->density.lo; d <= cfg->density.hi; d += cfg->density.step ) {
+                for ( int n = cfg->neighbor.lo; n <= cfg->neighbor.hi; n += cfg->neighbor.step ) {
+                    pool.points[i++] = (Point) { b, c, d, n };
+                }
+            }
+        }
+    }
+
+    int started = 0;
+    for ( ; started < cfg->workers; started++ ) {
+        if ( hire( &workers[started], &pool ) != 0
+             || pthread_create( &workers[started].thread, NULL, work, &workers[started] ) != 0 ) {
+            dismiss( &workers[started] );
+            pthread_mutex_lock( &pool.lock );
+            pool.failed = 1;
+            pthread_mutex_unlock( &pool.lock );
+            break;
+        }
+    }
+    for ( int w = 0; w < started; w++ ) {
+        pthread_join( workers[w].thread, NULL );
+        dismiss( &workers[w] );
+    }
+
+    int status = pool.failed ? -1 : 0;
+    if ( status == 0 ) {
+        report( &pool, points, out );
+    }
+
+    pthread_mutex_destroy( &pool.lock );
+    free( pool.points );
+    free( pool.outcomes );
+    free( workers );
+    return status;
+}
@@ -0,0 +1,77 @@
+/*
+ * File:    ensemble.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Monte Carlo ensembles for parameter sweeps. An ensemble runs every
+ * combination of a range of pBurning, pCatch, density and pNeighbor
+ * values a number of times, in one process, on a pool of worker
+ * threads. Each worker creates one simulation (see wildfire.h) and
+ * starts it over in the same grids for every run it takes, so runs are
+ * stepped by the very code of a single run. Replicate r of every parameter point uses seed
+ * S + r, so replicate 0 reproduces a single run with -S S, and every
+ * point is compared on the same random numbers.
+ *      The statistics of each parameter point are written as one CSV line
+ * in a fixed order, whatever the number of workers.
+ *
+ */
+
+#ifndef WILDFIRE_ENSEMBLE_H
+#define WILDFIRE_ENSEMBLE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "kernel.h"
+
+/// Inclusive range of integer percentages, lo, lo + step, ... <= hi.
+///
+typedef struct {
+    int lo;   ///< first value
+    int hi;   ///< last value, at least lo
+    int step; ///< distance between values, at least 1
+} Range;
+
+/// What an ensemble runs.
+///
+typedef struct {
+    size_t width;          ///< number of columns in the grid
+    size_t height;         ///< number of rows in the grid
+    Range burning;         ///< pBurning values, in percent
+    Range catching;        ///< pCatch values, in percent
+    Range density;         ///< density values, in percent
+    Range neighbor;        ///< pNeighbor values, in percent
+    int replicates;        ///< runs of every parameter point
+    int workers;           ///< number of worker threads
+    unsigned long seed;    ///< seed of replicate 0
+    long maxCycles;        ///< a run stops after this many cycles
+    RowKernel kernel;      ///< row kernel stepping the grids
+    Neighborhood hood;     ///< cells whose burning trees spread fire
+    int threshold;         ///< burning neighbors that spread fire, or 0 to
+                           ///< spread by the pNeighbor values
+} EnsembleConfig;
+
+/// Parses a range given as "N", "LO:HI" or "LO:HI:STEP".
+///
+/// @param text: the range
+/// @param range: receives the range
+/// @return 0 on success, -1 if the text is not a range
+///
+int ensemble_range( const char *text, Range *range );
+
+/// Runs an ensemble and writes one CSV line per parameter point, after
+/// a header line. Columns are the four parameters, the number of runs,
+/// the mean and variance of the fraction of trees burned, the mean and
+/// variance of the cycles until the fires were out (or maxCycles), the
+/// fraction of runs whose fires went out, and the percolation
+/// probability: the fraction of runs in which the burned trees formed an
+/// 8-connected path from the top row to the bottom row.
+///
+/// @param cfg: what to run
+/// @param out: where to write the CSV
+/// @return 0 on success, -1 if memory or threads could not be obtained
+///
+int ensemble_run( const EnsembleConfig *cfg, FILE *out );
+
+#endif
@@ -0,0 +1,185 @@
+// file: grid.c
+// Heap and mmap backed storage for the simulation grid.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers; MAP_ANONYMOUS, posix_memalign
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h> // memcpy, memset
+#include <sys/mman.h> // mmap, munmap
+
+#include "grid.h"
+#include "prof.h"
+#include "rng.h"
+
+/// Display character of each cell state. Burning trees all show as '*'.
+
+const char cell_char[256] = {
+    [CELL_EMPTY] = ' ',
+    [CELL_LIVING] = 'Y',
+    [CELL_KINDLED] = '*',
+    [CELL_BURN0] = '*',
+    [CELL_BURN1] = '*',
+    [CELL_BURN2] = '*',
+    [CELL_BURNT] = '.',
+};
+
+/// Cell state of each display character. Unknown characters are empty.
+
+const cell_t char_cell[256] = {
+    [' '] = CELL_EMPTY,
+    ['Y'] = CELL_LIVING,
+    ['*'] = CELL_KINDLED,
+    ['0'] = CELL_BURN0,
+    ['1'] = CELL_BURN1,
+    ['2'] = CELL_BURN2,
+    ['.'] = CELL_BURNT,
+};
+
+/// Allocates a grid header and lays out its rows, without the cells.
+/// @return the header, or NULL if the dimensions are invalid or
+///         the memory could not be obtained
+
+static Grid *layout( size_t width, size_t height ) {
+
+    if ( width == 0 || height == 0 || width > SIZE_MAX - GRID_ALIGN
+         || height > SIZE_MAX - 2 * GRID_HALO ) {
+        return NULL;
+    }
+
+    size_t padded = width + 2 * GRID_HALO;
+    size_t stride = ( padded + GRID_ALIGN - 1 ) & ~(size_t)( GRID_ALIGN - 1 );
+    size_t rows = height + 2 * GRID_HALO;
+    if ( rows > SIZE_MAX / stride ) {
+        return NULL; // dimensions overflow the address space
+    }
+
+    Grid *g = malloc( sizeof (Grid) );
+    if ( g == NULL ) {
+        return NULL;
+    }
+
+    g->width = width;
+    g->height = height;
+    g->stride = stride;
+    g->bytes = stride * rows;
+    g->mapped = 0;
+    g->base = NULL;
+    g->cells = NULL;
+
+    return g;
+}
+
+/// Allocates a grid of the given dimensions. The cells and the halo
+/// around them are empty.
+
+Grid *grid_create( size_t width, size_t height ) {
+
+    Grid *g = layout( width, height );
+    if ( g == NULL ) {
+        return NULL;
+    }
+
+    if ( g->bytes >= GRID_MMAP_THRESHOLD ) {
+        // anonymous mappings are page aligned and already zero filled
+        void *p = mmap( NULL, g->bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if ( p != MAP_FAILED ) {
+            g->base = p;
+            g->mapped = 1;
+        }
+    }
+
+    if ( g->base == NULL ) {
+        void *p = NULL;
+        if ( posix_memalign( &p, GRID_ALIGN, g->bytes ) != 0 ) {
+            free( g );
+            return NULL;
+        }
+        memset( p, CELL_EMPTY, g->bytes );
+        g->base = p;
+    }
+
+    g->cells = g->base + GRID_HALO * g->stride + GRID_HALO;
+
+    return g;
+}
+
+/// Maps a grid image from a file, copy-on-write.
+
+Grid *grid_map( int fd, uint64_t offset, size_t width, size_t height ) {
+
+    Grid *g = layout( width, height );
+    if ( g == NULL ) {
+        return NULL;
+    }
+
+    // a private mapping reads pages from the file as they are touched;
+    // writes go to private copies and never reach the file
+    void *p = mmap( NULL, g->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t) offset );
+    if ( p == MAP_FAILED ) {
+        free( g );
+        return NULL;
+    }
+
+    g->base = p;
+    g->mapped = 1;
+    g->cells = g->base + GRID_HALO * g->stride + GRID_HALO;
+
+    return g;
+}
+
+/// Releases a grid and its cells. NULL is ignored.
+
+void grid_destroy( Grid *g ) {
+    if ( g == NULL ) {
+        return;
+    }
+    if ( g->mapped ) {
+        munmap( g->base, g->bytes );
+    } else {
+        free( g->base );
+    }
+    free( g );
+}
+
+/// Copies the cells and halo of one grid into another of the same dimensions.
+
+void grid_copy( Grid *dst, const Grid *src ) {
+    memcpy( dst->base, src->base, src->bytes );
+}
+
+/// Fills a grid with living and burning trees at uniformly random places.
+
+void grid_populate( Grid *g, size_t living, size_t burning, uint64_t seed ) {
+
+    uint64_t key = rng_key( seed, RNG_INIT_STREAM );
+    size_t left = g->width * g->height; // cells not yet filled
+    size_t trees = living + burning; // trees not yet placed
+    size_t fires = burning; // burning trees not yet placed
+    size_t draws = 0; // counted for the profile only
+
+    for ( size_t r = 0; r < g->height; r++ ) {
+        cell_t *row = grid_row( g, r );
+        for ( size_t c = 0; c < g->width; c++ ) {
+            cell_t cell = CELL_EMPTY;
+            if ( trees > 0 ) {
+                uint64_t u = rng_below( key, r * g->width + c, left );
+                draws++;
+                if ( u < fires ) {
+                    cell = CELL_KINDLED;
+                    fires--;
+                    trees--;
+                } else if ( u < trees ) {
+                    cell = CELL_LIVING;
+                    trees--;
+                }
+            }
+            row[c] = cell;
+            left--;
+        }
+    }
+    PROF_COUNT( PROF_RNG_DRAWS, draws );
+}
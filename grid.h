@@ -0,0 +1,140 @@
+/*
+ * File:    grid.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Heap backed storage for the simulation grid. A grid is a
+ * rectangular block of cells stored row-major with a row stride that
+ * is rounded up to the cache line size. Small grids come from an
+ * aligned heap allocation; large grids are mapped directly from the
+ * kernel with mmap so that landscapes of 10k x 10k cells and beyond
+ * can be simulated. All indexing is done with size_t.
+ *      Cells hold a compact numeric state rather than a display
+ * character. Every grid is surrounded by a halo of empty cells so that
+ * the neighbors of any cell can be read without bounds checks.
+ *
+ */
+
+#ifndef WILDFIRE_GRID_H
+#define WILDFIRE_GRID_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GRID_ALIGN 64 ///< alignment of every row, in bytes
+
+#define GRID_MMAP_THRESHOLD (1UL << 20) ///< allocations this large use mmap
+
+#define GRID_HALO 2 ///< rows and columns of empty cells around the grid; the widest neighborhood reaches two
+
+/// Cell states. Bit 0 is set for any tree and bit 4 for a burning tree,
+/// so masking a cell with CELL_COUNT_MASK and adding up its neighbors
+/// gives the number of trees in the low nibble and the number of
+/// burning trees in the high nibble. Bits 5 and 6 hold the burn cycle.
+///
+typedef unsigned char cell_t;
+
+#define CELL_EMPTY   0x00 ///< no tree (' ')
+#define CELL_LIVING  0x01 ///< living tree ('Y')
+#define CELL_KINDLED 0x11 ///< tree burning at cycle 0 ('*')
+#define CELL_BURN0   0x31 ///< tree in its first cycle of burning ('0')
+#define CELL_BURN1   0x51 ///< tree in its second cycle of burning ('1')
+#define CELL_BURN2   0x71 ///< tree in its third cycle of burning ('2')
+#define CELL_BURNT   0x80 ///< burned out tree ('.')
+
+#define CELL_TREE       0x01 ///< bit set for any tree
+#define CELL_FIRE       0x10 ///< bit set for any burning tree
+#define CELL_COUNT_MASK ( CELL_TREE | CELL_FIRE ) ///< bits summed over neighbors
+#define CELL_MARK       0x02 ///< scratch bit an engine may set during a step
+
+/// Number of trees in a neighbor sum.
+#define SUM_TREES(sum) ( (sum) & 0x0f )
+
+/// Number of burning trees in a neighbor sum.
+#define SUM_FIRES(sum) ( (sum) >> 4 )
+
+/// A rectangular grid of cells.
+///
+typedef struct {
+    size_t width;  ///< number of cells in a row
+    size_t height; ///< number of rows
+    size_t stride; ///< distance in bytes between the starts of two rows
+    cell_t *cells; ///< first cell of row 0; the halo lies around it
+    cell_t *base;  ///< start of the underlying allocation
+    size_t bytes;  ///< size of the underlying allocation
+    int mapped;    ///< 1 if the allocation came from mmap
+} Grid;
+
+/// Display character of each cell state. Burning trees all show as '*'.
+extern const char cell_char[256];
+
+/// Cell state of each display character. Unknown characters are empty.
+extern const cell_t char_cell[256];
+
+/// Allocates a grid of the given dimensions. The cells and the halo
+/// around them are empty.
+///
+/// @param width: number of cells in a row
+/// @param height: number of rows
+/// @return the new grid, or NULL if the dimensions are invalid or
+///         the memory could not be obtained
+///
+Grid *grid_create( size_t width, size_t height );
+
+/// Maps a grid from a file without copying it. The file must hold the
+/// image of a grid of the same dimensions (its base, bytes long) at the
+/// given offset, which must be a multiple of the page size. The mapping
+/// is private: the grid may be stepped in place, and the pages it
+/// changes are copied on write, leaving the file untouched.
+///
+/// @param fd: file descriptor open for reading
+/// @param offset: position of the image in the file
+/// @param width: number of cells in a row
+/// @param height: number of rows
+/// @return the grid, or NULL if the dimensions are invalid or the file
+///         could not be mapped
+///
+Grid *grid_map( int fd, uint64_t offset, size_t width, size_t height );
+
+/// Releases a grid and its cells. NULL is ignored.
+///
+/// @param g: grid to be released
+///
+void grid_destroy( Grid *g );
+
+/// Copies the cells and halo of one grid into another of the same dimensions.
+///
+/// @param dst: grid to be overwritten
+/// @param src: grid to be copied
+///
+void grid_copy( Grid *dst, const Grid *src );
+
+/// Fills a grid with the given numbers of living and burning trees at
+/// uniformly random places, leaving the other cells empty. The cells are
+/// visited once, in order, and each is chosen with probability equal to
+/// the share of each kind still to be placed (selection sampling), so the
+/// whole grid is filled in linear time without a separate buffer. The
+/// placement depends only on the counts and the seed.
+///
+/// @param g: the grid
+/// @param living: number of living trees ('Y')
+/// @param burning: number of burning trees ('*')
+/// @param seed: seed of the random numbers
+///
+void grid_populate( Grid *g, size_t living, size_t burning, uint64_t seed );
+
+/// Returns the first cell of a row.
+///
+/// @param g: the grid
+/// @param r: the row
+///
+static inline cell_t *grid_row( const Grid *g, size_t r ) {
+    return g->cells + r * g->stride;
+}
+
+/// Accesses the cell at row r, column c.
+///
+#define GRID_AT(g, r, c) ( (g)->cells[ (size_t)(r) * (g)->stride + (size_t)(c) ] )
+
+#endif
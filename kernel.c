@@ -0,0 +1,397 @@
+// file: kernel.c
+// Scalar, SSE4.1 and AVX2 row kernels for the update step, generated for
+// every neighborhood and kind of rule, and the run time selection between
+// them.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#include <string.h> // strcmp
+
+#include "kernel.h"
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#define KERNEL_X86 1 // vector kernels are compiled in
+#include <immintrin.h>
+#else
+#define KERNEL_X86 0
+#endif
+
+#define NEVER 0xff // more burning neighbors than any cell can have
+
+#define ALWAYS_INLINE inline __attribute__(( always_inline ))
+
+/// Next state of every cell that does not catch fire. Burning trees
+/// advance one burn cycle; everything else stays the same.
+
+static const cell_t nextState[256] = {
+    [CELL_LIVING] = CELL_LIVING,
+    [CELL_KINDLED] = CELL_BURN0,
+    [CELL_BURN0] = CELL_BURN1,
+    [CELL_BURN1] = CELL_BURN2,
+    [CELL_BURN2] = CELL_BURNT,
+    [CELL_BURNT] = CELL_BURNT,
+};
+
+/// Fills a rule from the proportion of neighbors that must be burning.
+
+void kernel_rule( SpreadRule *rule, Neighborhood hood, float pNeighbor ) {
+
+    rule->hood = hood;
+    rule->kind = RULE_RATIO;
+    rule->threshold = NEVER;
+
+    for ( int sum = 0; sum < 256; sum++ ) {
+        int totalNeighbors = SUM_TREES(sum);
+        int burningNeighbors = SUM_FIRES(sum);
+        rule->spreads[sum] = totalNeighbors > 0
+            && ( (float) burningNeighbors/totalNeighbors ) > pNeighbor;
+    }
+
+    // the proportion only grows with the number of burning neighbors,
+    // so each tree count has a least number of burning neighbors
+    for ( int trees = 0; trees < KERNEL_MAX_NEIGHBORS + 1; trees++ ) {
+        rule->need[trees] = NEVER;
+        for ( int fires = 1; fires <= trees; fires++ ) {
+            if ( ( (float) fires/trees ) > pNeighbor ) {
+                rule->need[trees] = (unsigned char) fires;
+                break;
+            }
+        }
+    }
+}
+
+/// Fills a rule from the number of neighbors that must be burning.
+
+void kernel_threshold( SpreadRule *rule, Neighborhood hood, int fires ) {
+
+    rule->hood = hood;
+    rule->kind = RULE_THRESHOLD;
+    rule->threshold = (unsigned char)( fires < NEVER ? fires : NEVER );
+
+    for ( int sum = 0; sum < 256; sum++ ) {
+        rule->spreads[sum] = SUM_FIRES(sum) >= rule->threshold;
+    }
+    for ( int trees = 0; trees < KERNEL_MAX_NEIGHBORS + 1; trees++ ) {
+        rule->need[trees] = trees >= rule->threshold ? rule->threshold : NEVER;
+    }
+}
+
+/// Returns 1 if the neighbors of the living tree at p spread fire to it.
+/// The neighborhood and the kind of rule are constants in every caller, so
+/// each kernel is compiled with only its own sum and test.
+
+static ALWAYS_INLINE int spreads( const cell_t *p, size_t stride, const SpreadRule *rule,
+                                  Neighborhood hood, RuleKind kind ) {
+
+    const ptrdiff_t s = (ptrdiff_t) stride;
+
+    if ( hood == NEIGHBORHOOD_RADIUS2 ) {
+        // up to 24 trees overflow a nibble, so trees and fires are summed apart
+        unsigned trees = 0;
+        unsigned fires = 0;
+        for ( ptrdiff_t dr = -2; dr <= 2; dr++ ) {
+            for ( ptrdiff_t dc = -2; dc <= 2; dc++ ) {
+                if ( dr == 0 && dc == 0 ) {
+                    continue;
+                }
+                cell_t n = p[dr * s + dc];
+                trees += n & CELL_TREE;
+                fires += ( n & CELL_FIRE ) >> 4;
+            }
+        }
+        return kind == RULE_THRESHOLD ? fires >= rule->threshold : fires >= rule->need[trees];
+    }
+
+    unsigned sum = ( p[-s] & CELL_COUNT_MASK ) + ( p[-1] & CELL_COUNT_MASK )
+                 + ( p[1] & CELL_COUNT_MASK ) + ( p[s] & CELL_COUNT_MASK );
+    if ( hood == NEIGHBORHOOD_MOORE ) {
+        sum += ( p[-s - 1] & CELL_COUNT_MASK ) + ( p[-s + 1] & CELL_COUNT_MASK )
+             + ( p[s - 1] & CELL_COUNT_MASK ) + ( p[s + 1] & CELL_COUNT_MASK );
+    }
+    return kind == RULE_THRESHOLD ? SUM_FIRES(sum) >= rule->threshold : rule->spreads[sum];
+}
+
+/// Computes columns [from, to) of a row one cell at a time.
+/// Shared by the scalar kernels and the tails of the vector kernels.
+
+static ALWAYS_INLINE long scalarSpan( const cell_t *in, size_t stride, cell_t *out,
+                                      size_t from, size_t to, const SpreadRule *rule,
+                                      size_t *candidates, size_t *count,
+                                      Neighborhood hood, RuleKind kind ) {
+
+    long burnedOut = 0;
+    size_t n = *count;
+
+    for ( size_t c = from; c < to; c++ ) {
+        cell_t cell = in[c];
+        if ( cell == CELL_LIVING ) {
+            candidates[n] = c;
+            n += spreads( in + c, stride, rule, hood, kind );
+        }
+        burnedOut += cell == CELL_BURN2;
+        out[c] = nextState[cell];
+    }
+
+    *count = n;
+    return burnedOut;
+}
+
+/// Emits the scalar kernel of one neighborhood and rule.
+
+#define SCALAR_KERNEL(name, hood, kind)                                         \
+    static long scalar##name( const cell_t *in, size_t stride, cell_t *out,     \
+                              size_t width, const SpreadRule *rule,             \
+                              size_t *candidates, size_t *count ) {             \
+        *count = 0;                                                             \
+        return scalarSpan( in, stride, out, 0, width, rule, candidates, count,  \
+                           hood, kind );                                        \
+    }
+
+SCALAR_KERNEL(MooreRatio, NEIGHBORHOOD_MOORE, RULE_RATIO)
+SCALAR_KERNEL(MooreThreshold, NEIGHBORHOOD_MOORE, RULE_THRESHOLD)
+SCALAR_KERNEL(VonNeumannRatio, NEIGHBORHOOD_VON_NEUMANN, RULE_RATIO)
+SCALAR_KERNEL(VonNeumannThreshold, NEIGHBORHOOD_VON_NEUMANN, RULE_THRESHOLD)
+SCALAR_KERNEL(Radius2Ratio, NEIGHBORHOOD_RADIUS2, RULE_RATIO)
+SCALAR_KERNEL(Radius2Threshold, NEIGHBORHOOD_RADIUS2, RULE_THRESHOLD)
+
+#if KERNEL_X86
+
+/// Computes one row of the next cycle 16 cells at a time.
+/// Masked neighbor rows are added as vectors, the least number of burning
+/// neighbors for each tree count is looked up with a byte shuffle, and the
+/// burn cycle transitions are applied with blends. Threshold rules compare
+/// the burning neighbors with a constant and need no tree count at all.
+/// The radius 2 neighborhood is not vectorized: its sums overflow a nibble.
+
+__attribute__(( target("sse4.1") ))
+static ALWAYS_INLINE long sseSpan( const cell_t *in, size_t stride, cell_t *out,
+                                   size_t width, const SpreadRule *rule,
+                                   size_t *candidates, size_t *count,
+                                   Neighborhood hood, RuleKind kind ) {
+
+    const __m128i mask = _mm_set1_epi8( kind == RULE_THRESHOLD ? CELL_FIRE : CELL_COUNT_MASK );
+    const __m128i low = _mm_set1_epi8( 0x0f );
+    const __m128i need = kind == RULE_THRESHOLD ? _mm_set1_epi8( (char) rule->threshold )
+                                                : _mm_loadu_si128( (const __m128i *) rule->need );
+    const __m128i living = _mm_set1_epi8( CELL_LIVING );
+    const __m128i fire = _mm_set1_epi8( CELL_FIRE );
+    const __m128i step = _mm_set1_epi8( CELL_BURN0 - CELL_KINDLED );
+    const __m128i last = _mm_set1_epi8( (char) CELL_BURN2 );
+    const __m128i burnt = _mm_set1_epi8( (char) CELL_BURNT );
+
+    long burnedOut = 0;
+    size_t n = 0;
+    size_t c = 0;
+
+#define LOAD(p) _mm_and_si128( _mm_loadu_si128( (const __m128i *)(p) ), mask )
+
+    for ( ; c + 16 <= width; c += 16 ) {
+        const cell_t *p = in + c;
+        __m128i sum = _mm_add_epi8( LOAD(p - stride), LOAD(p - 1) );
+        sum = _mm_add_epi8( sum, LOAD(p + 1) );
+        sum = _mm_add_epi8( sum, LOAD(p + stride) );
+        if ( hood == NEIGHBORHOOD_MOORE ) {
+            sum = _mm_add_epi8( sum, LOAD(p - stride - 1) );
+            sum = _mm_add_epi8( sum, LOAD(p - stride + 1) );
+            sum = _mm_add_epi8( sum, LOAD(p + stride - 1) );
+            sum = _mm_add_epi8( sum, LOAD(p + stride + 1) );
+        }
+
+        __m128i fires = _mm_and_si128( _mm_srli_epi16( sum, 4 ), low );
+        __m128i needed = kind == RULE_THRESHOLD ? need
+                       : _mm_shuffle_epi8( need, _mm_and_si128( sum, low ) );
+        __m128i spread = _mm_cmpeq_epi8( _mm_max_epu8( fires, needed ), fires );
+
+        __m128i cell = _mm_loadu_si128( (const __m128i *) p );
+        __m128i cand = _mm_and_si128( spread, _mm_cmpeq_epi8( cell, living ) );
+        __m128i burning = _mm_cmpeq_epi8( _mm_and_si128( cell, fire ), fire );
+        __m128i ending = _mm_cmpeq_epi8( cell, last );
+
+        __m128i next = _mm_blendv_epi8( cell, _mm_add_epi8( cell, step ), burning );
+        next = _mm_blendv_epi8( next, burnt, ending );
+        _mm_storeu_si128( (__m128i *)( out + c ), next );
+
+        burnedOut += __builtin_popcount( (unsigned) _mm_movemask_epi8( ending ) );
+        unsigned bits = (unsigned) _mm_movemask_epi8( cand );
+        while ( bits ) {
+            candidates[n++] = c + (size_t) __builtin_ctz( bits );
+            bits &= bits - 1;
+        }
+    }
+
+#undef LOAD
+
+    *count = n;
+    return burnedOut + scalarSpan( in, stride, out, c, width, rule, candidates, count,
+                                   hood, kind );
+}
+
+/// Computes one row of the next cycle 32 cells at a time.
+/// Same algorithm as sseSpan; the need table is repeated in both lanes.
+
+__attribute__(( target("avx2") ))
+static ALWAYS_INLINE long avx2Span( const cell_t *in, size_t stride, cell_t *out,
+                                    size_t width, const SpreadRule *rule,
+                                    size_t *candidates, size_t *count,
+                                    Neighborhood hood, RuleKind kind ) {
+
+    const __m256i mask = _mm256_set1_epi8( kind == RULE_THRESHOLD ? CELL_FIRE : CELL_COUNT_MASK );
+    const __m256i low = _mm256_set1_epi8( 0x0f );
+    const __m256i need = kind == RULE_THRESHOLD ? _mm256_set1_epi8( (char) rule->threshold )
+                       : _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i *) rule->need ) );
+    const __m256i living = _mm256_set1_epi8( CELL_LIVING );
+    const __m256i fire = _mm256_set1_epi8( CELL_FIRE );
+    const __m256i step = _mm256_set1_epi8( CELL_BURN0 - CELL_KINDLED );
+    const __m256i last = _mm256_set1_epi8( (char) CELL_BURN2 );
+    const __m256i burnt = _mm256_set1_epi8( (char) CELL_BURNT );
+
+    long burnedOut = 0;
+    size_t n = 0;
+    size_t c = 0;
+
+#define LOAD(p) _mm256_and_si256( _mm256_loadu_si256( (const __m256i *)(p) ), mask )
+
+    for ( ; c + 32 <= width; c += 32 ) {
+        const cell_t *p = in + c;
+        __m256i sum = _mm256_add_epi8( LOAD(p - stride), LOAD(p - 1) );
+        sum = _mm256_add_epi8( sum, LOAD(p + 1) );
+        sum = _mm256_add_epi8( sum, LOAD(p + stride) );
+        if ( hood == NEIGHBORHOOD_MOORE ) {
+            sum = _mm256_add_epi8( sum, LOAD(p - stride - 1) );
+            sum = _mm256_add_epi8( sum, LOAD(p - stride + 1) );
+            sum = _mm256_add_epi8( sum, LOAD(p + stride - 1) );
+            sum = _mm256_add_epi8( sum, LOAD(p + stride + 1) );
+        }
+
+        __m256i fires = _mm256_and_si256( _mm256_srli_epi16( sum, 4 ), low );
+        __m256i needed = kind == RULE_THRESHOLD ? need
+                       : _mm256_shuffle_epi8( need, _mm256_and_si256( sum, low ) );
+        __m256i spread = _mm256_cmpeq_epi8( _mm256_max_epu8( fires, needed ), fires );
+
+        __m256i cell = _mm256_loadu_si256( (const __m256i *) p );
+        __m256i cand = _mm256_and_si256( spread, _mm256_cmpeq_epi8( cell, living ) );
+        __m256i burning = _mm256_cmpeq_epi8( _mm256_and_si256( cell, fire ), fire );
+        __m256i ending = _mm256_cmpeq_epi8( cell, last );
+
+        __m256i next = _mm256_blendv_epi8( cell, _mm256_add_epi8( cell, step ), burning );
+        next = _mm256_blendv_epi8( next, burnt, ending );
+        _mm256_storeu_si256( (__m256i *)( out + c ), next );
+
+        burnedOut += __builtin_popcount( (unsigned) _mm256_movemask_epi8( ending ) );
+        unsigned bits = (unsigned) _mm256_movemask_epi8( cand );
+        while ( bits ) {
+            candidates[n++] = c + (size_t) __builtin_ctz( bits );
+            bits &= bits - 1;
+        }
+    }
+
+#undef LOAD
+
+    *count = n;
+    return burnedOut + scalarSpan( in, stride, out, c, width, rule, candidates, count,
+                                   hood, kind );
+}
+
+/// Emits the SSE4.1 and AVX2 kernels of one neighborhood and rule.
+
+#define VECTOR_KERNELS(name, hood, kind)                                        \
+    __attribute__(( target("sse4.1") ))                                         \
+    static long sse##name( const cell_t *in, size_t stride, cell_t *out,        \
+                           size_t width, const SpreadRule *rule,                \
+                           size_t *candidates, size_t *count ) {                \
+        return sseSpan( in, stride, out, width, rule, candidates, count,        \
+                        hood, kind );                                           \
+    }                                                                           \
+    __attribute__(( target("avx2") ))                                           \
+    static long avx2##name( const cell_t *in, size_t stride, cell_t *out,       \
+                            size_t width, const SpreadRule *rule,               \
+                            size_t *candidates, size_t *count ) {               \
+        return avx2Span( in, stride, out, width, rule, candidates, count,       \
+                         hood, kind );                                          \
+    }
+
+VECTOR_KERNELS(MooreRatio, NEIGHBORHOOD_MOORE, RULE_RATIO)
+VECTOR_KERNELS(MooreThreshold, NEIGHBORHOOD_MOORE, RULE_THRESHOLD)
+VECTOR_KERNELS(VonNeumannRatio, NEIGHBORHOOD_VON_NEUMANN, RULE_RATIO)
+VECTOR_KERNELS(VonNeumannThreshold, NEIGHBORHOOD_VON_NEUMANN, RULE_THRESHOLD)
+
+#endif
+
+/// The kernels of one instruction set, by neighborhood and kind of rule.
+/// A missing kernel falls back to the scalar one.
+
+typedef struct {
+    const char *name;
+    RowKernel kernels[NEIGHBORHOODS][RULES];
+} KernelSet;
+
+static const KernelSet sets[] = {
+    { "scalar", { { scalarMooreRatio, scalarMooreThreshold },
+                  { scalarVonNeumannRatio, scalarVonNeumannThreshold },
+                  { scalarRadius2Ratio, scalarRadius2Threshold } } },
+#if KERNEL_X86
+    { "sse", { { sseMooreRatio, sseMooreThreshold },
+               { sseVonNeumannRatio, sseVonNeumannThreshold },
+               { NULL, NULL } } },
+    { "avx2", { { avx2MooreRatio, avx2MooreThreshold },
+                { avx2VonNeumannRatio, avx2VonNeumannThreshold },
+                { NULL, NULL } } },
+#endif
+};
+
+#define SETS ( sizeof sets / sizeof sets[0] )
+
+/// Returns the set holding a kernel, or the scalar set.
+
+static const KernelSet *setOf( RowKernel k ) {
+    for ( size_t i = 0; i < SETS; i++ ) {
+        for ( int h = 0; h < NEIGHBORHOODS; h++ ) {
+            for ( int r = 0; r < RULES; r++ ) {
+                if ( sets[i].kernels[h][r] == k ) {
+                    return &sets[i];
+                }
+            }
+        }
+    }
+    return &sets[0];
+}
+
+/// Selects a row kernel.
+
+RowKernel kernel_select( const char *name ) {
+
+    int avx2 = 0;
+    int sse = 0;
+
+#if KERNEL_X86
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports( "avx2" );
+    sse = __builtin_cpu_supports( "sse4.1" );
+#endif
+
+    if ( name == NULL ) {
+        name = avx2 ? "avx2" : sse ? "sse" : "scalar";
+    }
+
+    for ( size_t i = 0; i < SETS; i++ ) {
+        if ( strcmp( name, sets[i].name ) == 0 ) {
+            int supported = strcmp( name, "avx2" ) == 0 ? avx2
+                          : strcmp( name, "sse" ) == 0 ? sse : 1;
+            return supported ? sets[i].kernels[NEIGHBORHOOD_MOORE][RULE_RATIO] : NULL;
+        }
+    }
+    return NULL;
+}
+
+/// Returns the kernel of the same instruction set specialized for a rule.
+
+RowKernel kernel_specialize( RowKernel k, const SpreadRule *rule ) {
+    RowKernel special = setOf( k )->kernels[rule->hood][rule->kind];
+    return special != NULL ? special : sets[0].kernels[rule->hood][rule->kind];
+}
+
+/// Returns the name of a kernel returned by kernel_select or kernel_specialize.
+
+const char *kernel_name( RowKernel k ) {
+    return setOf( k )->name;
+}
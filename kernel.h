@@ -0,0 +1,126 @@
+/*
+ * File:    kernel.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Row kernels for the update step. A kernel computes one whole row
+ * of the next cycle: it advances every burning tree one burn cycle and
+ * reports the columns of the living trees whose neighbors spread fire to
+ * them. Whether those trees actually catch fire is drawn by the caller,
+ * so every kernel produces the same grid for the same random numbers.
+ *      A tree's neighbors are its Moore (8 cells), von Neumann (4 cells)
+ * or radius 2 (24 cells) neighborhood. Fire spreads to it when the
+ * proportion of burning trees among its tree neighbors is above
+ * pNeighbor, or when at least a fixed number of them are burning. The
+ * rule is reduced to integer tables once; no kernel divides.
+ *      One kernel is generated for every neighborhood and kind of rule,
+ * with both compiled into its inner loop. Vector kernels use SSE4.1 or
+ * AVX2 and are selected at run time from what the processor supports.
+ * The scalar kernels work everywhere, and step the radius 2
+ * neighborhood for every instruction set.
+ *
+ */
+
+#ifndef WILDFIRE_KERNEL_H
+#define WILDFIRE_KERNEL_H
+
+#include <stddef.h>
+
+#include "grid.h"
+
+#define KERNEL_MAX_NEIGHBORS 24 ///< cells in the largest neighborhood
+
+/// Cells whose burning trees spread fire to a tree.
+///
+typedef enum {
+    NEIGHBORHOOD_MOORE,       ///< the 8 cells around, diagonals included
+    NEIGHBORHOOD_VON_NEUMANN, ///< the 4 cells north, west, east and south
+    NEIGHBORHOOD_RADIUS2,     ///< the 24 cells within two rows and columns;
+                              ///< needs GRID_HALO of 2
+    NEIGHBORHOODS
+} Neighborhood;
+
+/// How the burning neighbors of a tree decide whether fire spreads.
+///
+typedef enum {
+    RULE_RATIO,     ///< burning over tree neighbors above pNeighbor
+    RULE_THRESHOLD, ///< at least a number of burning neighbors
+    RULES
+} RuleKind;
+
+/// Neighbor counts that spread fire, derived from pNeighbor or from a
+/// threshold.
+///
+typedef struct {
+    Neighborhood hood;          ///< cells counted as neighbors
+    RuleKind kind;              ///< kind of rule
+    unsigned char threshold;    ///< burning neighbors needed by RULE_THRESHOLD
+    unsigned char need[32];     ///< fewest burning neighbors that spread fire,
+                                ///< indexed by number of tree neighbors
+    unsigned char spreads[256]; ///< 1 for each neighbor sum (see grid.h) that
+                                ///< spreads fire; Moore and von Neumann only
+} SpreadRule;
+
+/// Computes one row of the next cycle.
+///
+/// @param in: first cell of the row in the current cycle; the rows above
+///            and below are read through stride
+/// @param stride: distance between rows of the current cycle
+/// @param out: first cell of the row in the next cycle
+/// @param width: number of cells in the row
+/// @param rule: neighbor sums that spread fire
+/// @param candidates: receives, in increasing order, the columns of the
+///                    living trees that may catch fire
+/// @param count: receives the number of candidates
+/// @return the number of trees that burned out
+///
+typedef long (*RowKernel)( const cell_t *in, size_t stride, cell_t *out,
+                           size_t width, const SpreadRule *rule,
+                           size_t *candidates, size_t *count );
+
+/// Fills a rule from the proportion of neighbors that must be burning.
+/// A sum spreads fire when burning/total > pNeighbor, exactly as the
+/// original per-tree computation.
+///
+/// @param rule: the rule to fill
+/// @param hood: cells counted as neighbors
+/// @param pNeighbor: proportion of neighbors that influence catching fire
+///
+void kernel_rule( SpreadRule *rule, Neighborhood hood, float pNeighbor );
+
+/// Fills a rule from the number of neighbors that must be burning.
+///
+/// @param rule: the rule to fill
+/// @param hood: cells counted as neighbors
+/// @param fires: fewest burning neighbors that spread fire, at least 1
+///
+void kernel_threshold( SpreadRule *rule, Neighborhood hood, int fires );
+
+/// Selects a row kernel.
+///
+/// @param name: "scalar", "sse" or "avx2" to request a kernel, or NULL
+///              for the fastest one the processor supports
+/// @return the Moore ratio kernel, or NULL if the named kernel is unknown
+///         or not supported by this processor
+///
+RowKernel kernel_select( const char *name );
+
+/// Returns the kernel generated for the neighborhood and kind of a rule,
+/// from the same instruction set as a kernel returned by kernel_select,
+/// or the scalar one if that set has none. Called once before stepping.
+///
+/// @param k: the kernel
+/// @param rule: the rule to be stepped
+/// @return the specialized kernel
+///
+RowKernel kernel_specialize( RowKernel k, const SpreadRule *rule );
+
+/// Returns the name of the instruction set of a kernel returned by
+/// kernel_select or kernel_specialize.
+///
+/// @param k: the kernel
+///
+const char *kernel_name( RowKernel k );
+
+#endif
@@ -0,0 +1,1041 @@
+// file: main.c
+// The command line program of the simulation of spreading fire. The program
+// implements a combination of [Shiflet] Assignents with variations. The state
+// of the system is repeatedly computed (see wildfire.h) and displayed to show
+// the progression of a forest fire. Cursor-control functions are used to show
+// changes to the grid as the fire spreads. The optional print mode prints
+// another grid for each simulation cycle.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers 
+
+#include <unistd.h> // usleep, isatty, read
+#include <poll.h> // keys read during the delay
+#include <signal.h> // terminal restored on interrupt
+#include <sys/ioctl.h> // terminal size
+#include <termios.h> // keys read one at a time
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // strcmp, strerror
+#include <time.h> // clock_gettime
+#include <getopt.h> // processes command line arguments that begin with (-) 
+#include "wildfire.h" // the simulation
+#include "display.h" // display cursor
+#include "grid.h" // heap allocated grid
+#include "kernel.h" // row kernels
+#include "ensemble.h" // parameter sweeps
+#include "checkpoint.h" // snapshots of a run
+#include "raster.h" // landscapes loaded from files
+#include "prof.h" // optional instrumentation
+#include "record.h" // trajectories of a run
+#include "render.h" // overlay display thread
+#include "domain.h" // worker processes
+#include <errno.h>
+#include <limits.h> 
+
+// default values for the command line
+
+#define DEFAULT_PRINT_COUNT 0 // print mode is turned off and overlay display mode is on
+#define DEFAULT_CHECKPOINT "wildfire.ckpt" // default checkpoint file
+#define DEFAULT_RECORD_KEYS 100 // default cycles between keyframes of a trajectory
+#define DEFAULT_DELAY 750 // default milliseconds between cycles on display
+#define DEFAULT_FPS 30 // default most frames drawn a second in overlay mode
+#define DEFAULT_TERM_ROWS 24 // terminal size assumed when it cannot be read
+#define DEFAULT_TERM_COLS 80
+
+#define OPT_CHECKPOINT_EVERY 256 // --checkpoint-every; above any short option
+#define OPT_CHECKPOINT_FILE 257 // --checkpoint-file
+#define OPT_RESUME 258 // --resume
+#define OPT_LANDSCAPE 259 // --landscape
+#define OPT_NEIGHBORHOOD 260 // --neighborhood
+#define OPT_THRESHOLD 261 // --threshold
+#define OPT_TIME_BLOCK 262 // --time-block
+#define OPT_RECORD 263 // --record
+#define OPT_RECORD_KEYS 264 // --record-keys
+#define OPT_DELAY 265 // --delay
+#define OPT_FPS 266 // --fps
+#define OPT_WINDOW 267 // --window
+#define OPT_OVERVIEW 268 // --overview
+#define OPT_PROCESSES 269 // --processes
+
+//
+
+static WildfireConfig cfg; // what is simulated; filled from the command line
+
+static int print = DEFAULT_PRINT_COUNT; // print mode; 1 if on, 0 if off
+
+static int quiet = 0; // headless mode; 1 if on, 0 if off
+
+static int replicates = 0; // runs of every parameter point; 0 unless in ensemble mode
+
+static int processes = 0; // worker processes stepping subdomains; 0 to step in this process
+
+static Renderer *screen = NULL; // render thread of the overlay display mode
+
+static long delay = DEFAULT_DELAY; // milliseconds between cycles on display
+
+static int fps = DEFAULT_FPS; // most frames drawn a second in overlay mode
+
+static char *line = NULL; // display characters of one row of the grid
+
+static cell_t *piece = NULL; // cells of one row of the window on display
+
+static int viewRows = 0; // rows of characters of the grid on display in overlay mode
+
+static int viewCols = 0; // columns of characters of the grid on display in overlay mode
+
+static long viewRow = 0; // first row of the grid in the window on display
+
+static long viewCol = 0; // first column of the grid in the window on display
+
+static int overview = -1; // 1 to show the whole grid downsampled, 0 a window; -1 until chosen
+
+static int panning = 0; // 1 while keys pan the window; the terminal is then in raw mode
+
+static struct termios cooked; // terminal settings to restore at exit
+
+static int shownCycle = 0; // cycle last handed to the display
+
+static int cycle = INT_MAX; // cycles left to run
+
+static Wildfire *sim = NULL; // the simulation
+
+static WildfireCounters counters; // counters of the simulation after the last cycle
+
+static long checkpointEvery = 0; // cycles between checkpoints; 0 for none
+
+static const char *checkpointPath = DEFAULT_CHECKPOINT; // where checkpoints are written
+
+static const char *recordPath = NULL; // trajectory written; NULL for none
+
+static long recordKeys = DEFAULT_RECORD_KEYS; // cycles between keyframes of the trajectory
+
+static Recorder *recorder = NULL; // writer of the trajectory
+
+/// Long options. Each one that takes an argument is handled with the short ones.
+
+static const struct option longOptions[] = {
+    { "checkpoint-every", required_argument, NULL, OPT_CHECKPOINT_EVERY },
+    { "checkpoint-file", required_argument, NULL, OPT_CHECKPOINT_FILE },
+    { "resume", required_argument, NULL, OPT_RESUME },
+    { "landscape", required_argument, NULL, OPT_LANDSCAPE },
+    { "neighborhood", required_argument, NULL, OPT_NEIGHBORHOOD },
+    { "threshold", required_argument, NULL, OPT_THRESHOLD },
+    { "time-block", required_argument, NULL, OPT_TIME_BLOCK },
+    { "record", required_argument, NULL, OPT_RECORD },
+    { "record-keys", required_argument, NULL, OPT_RECORD_KEYS },
+    { "delay", required_argument, NULL, OPT_DELAY },
+    { "fps", required_argument, NULL, OPT_FPS },
+    { "window", required_argument, NULL, OPT_WINDOW },
+    { "overview", no_argument, NULL, OPT_OVERVIEW },
+    { "processes", required_argument, NULL, OPT_PROCESSES },
+    { NULL, 0, NULL, 0 },
+};
+
+// function declarations //
+static void help();
+static double seconds();
+static void saveCheckpoint();
+static void recordCycle();
+static void rowText( const cell_t *row, char *text );
+static void fitView();
+static void clampView();
+static char blockChar( const SummaryCounts *s );
+static void fillView( char *text );
+static void showCycle( int currCycle, int last );
+static void restoreKeys();
+static void interrupted( int sig );
+static void startKeys();
+static void pan( char key );
+static void idle( long ms );
+static void summarize( double elapsed, long stepped );
+int main( int argc, char * argv[] );
+
+/// help function gives instructions. Prints usage information to stderr.
+
+static void help() {
+    fprintf( stderr, "usage: wildfire [options]\n" );
+    fprintf( stderr, "By default, the simulation runs in overlay display mode.\n" );
+    fprintf( stderr, "The -pN option makes the simulation run in print mode for up to N cycles.\n" );
+    printf("\n");
+    fprintf( stderr, "Simulation Configuration Options:\n" );
+    fprintf( stderr, " -H # View simulation options and quit.\n" ); 
+    fprintf( stderr, " -bN # proportion of trees that are already burning. 0 < N < 101.\n" );
+    fprintf( stderr, " -cN # probability that a tree will catch fire. 0 < N < 101.\n" );
+    fprintf( stderr, " -dN # density/proportion of trees in the grid. 0 < N < 101.\n" );
+    fprintf( stderr, " -nN # proportion of neighbors that influence a tree catching fire. -1 < N < 101.\n" );
+    fprintf( stderr, " -pN # number of cycles to print before quitting. -1 < N < ...\n" );
+    fprintf( stderr, " -q # headless mode: no display or delay, print a summary at the end.\n" );
+    fprintf( stderr, " -sN # simulation grid size (width and height). 4 < N.\n" );
+    fprintf( stderr, " -wN # simulation grid width. 4 < N.\n" );
+    fprintf( stderr, " -hN # simulation grid height. 4 < N.\n" );
+    fprintf( stderr, " -kNAME # step kernel: scalar, sse or avx2. default: fastest supported.\n" );
+    fprintf( stderr, " -tN # number of threads stepping the grid. 0 < N.\n" );
+    fprintf( stderr, " -SN # seed of the random numbers. -1 < N.\n" );
+    fprintf( stderr, " -eNAME # stepping engine: dense, sparse, packed, tiled or counted. default: dense.\n" );
+    fprintf( stderr, " -mN # ensemble mode: run every combination of -b, -c, -d and -n N times\n" );
+    fprintf( stderr, "       on -t threads and print statistics as CSV. 0 < N.\n" );
+    fprintf( stderr, "       -b, -c, -d and -n then accept ranges LO:HI:STEP.\n" );
+    fprintf( stderr, " --checkpoint-every N # save the state every N cycles. 0 < N.\n" );
+    fprintf( stderr, " --checkpoint-file FILE # where checkpoints are saved. default: %s.\n", DEFAULT_CHECKPOINT );
+    fprintf( stderr, " --resume FILE # continue the run saved in a checkpoint.\n" );
+    fprintf( stderr, " --landscape FILE # load cycle 0 from a PGM or ESRI ASCII grid raster.\n" );
+    fprintf( stderr, " --neighborhood NAME # neighbors of a tree: moore, von-neumann or radius2.\n" );
+    fprintf( stderr, "       default: moore. The sparse and packed engines step moore only.\n" );
+    fprintf( stderr, " --threshold N # fire spreads with at least N burning neighbors, instead of -n.\n" );
+    fprintf( stderr, " --time-block N # with -q, the dense engine advances each tile N cycles at once.\n" );
+    fprintf( stderr, " --record FILE # write every cycle to a trajectory, read back by replay.\n" );
+    fprintf( stderr, " --record-keys N # cycles between keyframes of the trajectory. 0 < N. default: %d.\n", DEFAULT_RECORD_KEYS );
+    fprintf( stderr, " --delay MS # milliseconds between cycles on display. -1 < MS. default: %d.\n", DEFAULT_DELAY );
+    fprintf( stderr, " --fps N # most frames drawn a second in overlay mode. 0 < N. default: %d.\n", DEFAULT_FPS );
+    fprintf( stderr, " --window ROW,COL # overlay mode shows the part of the grid from cell ROW,COL\n" );
+    fprintf( stderr, "       that fits the terminal. default: 0,0 if the whole grid fits.\n" );
+    fprintf( stderr, " --overview # overlay mode shows the whole grid, a block of cells per character.\n" );
+    fprintf( stderr, "       default if the grid does not fit the terminal. While the grid is shown,\n" );
+    fprintf( stderr, "       h j k l or the arrow keys pan the window and o switches to or from the overview.\n" );
+    fprintf( stderr, " --processes N # with -q, split the grid over N worker processes. 0 < N.\n" );
+    printf("\n");
+    printf("\n");
+    exit(0);
+}
+
+/// Reads the monotonic clock.
+/// @return seconds since an arbitrary point in the past
+
+static double seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// Saves the state of the simulation to the checkpoint file. A checkpoint that
+/// cannot be written is reported and the run goes on; the previous one is kept.
+
+static void saveCheckpoint() {
+
+    const Grid *g = wildfire_grid(sim);
+    if ( g == NULL ) {
+        fprintf( stderr, "not enough memory to write checkpoint %s.\n", checkpointPath);
+        return;
+    }
+
+    Snapshot s = {
+        .width = cfg.width, .height = cfg.height, .seed = cfg.seed, .step = (uint64_t)counters.step,
+        .cycle = cycle, .cChanges = counters.cChanges, .totalTrees = counters.totalTrees,
+        .fireTrees = counters.fireTrees, .livingTrees = counters.livingTrees,
+        .spaces = counters.spaces, .initialTrees = counters.initialTrees,
+        .pCatch = cfg.pCatch, .density = cfg.density, .pBurning = cfg.pBurning, .pNeighbor = cfg.pNeighbor,
+    };
+
+    if ( checkpoint_save(checkpointPath, &s, g) != 0 ) {
+        fprintf( stderr, "cannot write checkpoint %s: %s\n", checkpointPath, strerror(errno));
+    }
+}
+
+/// Appends the current cycle to the trajectory. A cycle that cannot be
+/// recorded ends the run, as a trajectory with a cycle missing is useless.
+
+static void recordCycle() {
+
+    PROF_NOW(recorded);
+    const Grid *g = wildfire_grid(sim);
+    if ( g == NULL ) {
+        fprintf( stderr, "not enough memory to record trajectory %s.\n", recordPath);
+        exit(EXIT_FAILURE);
+    }
+    if ( record_cycle(recorder, (uint64_t)counters.step, g) != 0 ) {
+        fprintf( stderr, "cannot write trajectory %s: %s\n", recordPath, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    PROF_PHASE(PROF_RECORD, recorded);
+}
+
+/// Converts one row of the grid to display characters.
+/// Burning trees all display as '*'.
+/// @param row first cell of the row
+/// @param text receives the characters, one per column
+
+static void rowText( const cell_t *row, char *text ) {
+    for (size_t j = 0; j < cfg.width; j++) {
+        text[j] = cell_char[row[j]];
+    }
+}
+
+/// Sizes the grid on display in overlay mode to the terminal, less the
+/// status lines, and keeps the window inside the grid. The whole grid is
+/// shown as a window from 0,0 if it fits; otherwise the overview is shown
+/// unless a window was asked for. Called once, before the renderer is
+/// started at this size.
+
+static void fitView() {
+    struct winsize ws;
+    int rows = DEFAULT_TERM_ROWS;
+    int cols = DEFAULT_TERM_COLS;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > RENDER_STATUS_LINES && ws.ws_col > 0) {
+        rows = ws.ws_row;
+        cols = ws.ws_col;
+    }
+    rows -= RENDER_STATUS_LINES;
+    viewRows = cfg.height < (size_t)rows ? (int)cfg.height : rows;
+    viewCols = cfg.width < (size_t)cols ? (int)cfg.width : cols;
+    if (overview < 0) {
+        overview = viewRows < (int)cfg.height || viewCols < (int)cfg.width;
+    }
+    clampView();
+}
+
+/// Keeps the window inside the grid, at the size the renderer was started
+/// with.
+
+static void clampView() {
+    long rowEnd = (long)cfg.height - viewRows; // last first row of a window inside the grid
+    long colEnd = (long)cfg.width - viewCols;
+    viewRow = viewRow < 0 ? 0 : viewRow > rowEnd ? rowEnd : viewRow;
+    viewCol = viewCol < 0 ? 0 : viewCol > colEnd ? colEnd : viewCol;
+}
+
+/// Picks the character of a block of the overview: '*' if any of its
+/// trees is burning, or else the character of its most common cell.
+/// @param s counts of the block
+/// @return display character
+
+static char blockChar( const SummaryCounts *s ) {
+    uint64_t empty = s->cells - s->living - s->burnt;
+    if (s->burning > 0) {
+        return cell_char[CELL_BURN0];
+    }
+    if (s->living >= s->burnt && s->living >= empty) {
+        return cell_char[CELL_LIVING];
+    }
+    return s->burnt >= empty ? cell_char[CELL_BURNT] : cell_char[CELL_EMPTY];
+}
+
+/// Fills the grid characters of a frame from the window or the overview.
+/// A character of the overview stands for a block of cells, a whole number
+/// of summary tiles down and across unless the whole grid fits the view,
+/// so that its counts cost the tiles its edges cross and not its cells.
+/// @param text receives viewRows by viewCols characters
+
+static void fillView( char *text ) {
+
+    if (overview == 0) {
+        for (int i = 0; i < viewRows; i++) {
+            wildfire_cells(sim, (size_t)viewRow + i, (size_t)viewCol, (size_t)viewCols, piece);
+            for (int j = 0; j < viewCols; j++) {
+                text[(size_t)i * viewCols + j] = cell_char[piece[j]];
+            }
+        }
+        return;
+    }
+
+    size_t bh = (cfg.height + viewRows - 1) / viewRows; // rows of cells of a block
+    size_t bw = (cfg.width + viewCols - 1) / viewCols; // columns of cells of a block
+    if (cfg.height > (size_t)viewRows || cfg.width > (size_t)viewCols) {
+        bh = (bh + SUMMARY_TILE - 1) / SUMMARY_TILE * SUMMARY_TILE;
+        bw = (bw + SUMMARY_TILE - 1) / SUMMARY_TILE * SUMMARY_TILE;
+    }
+    for (int i = 0; i < viewRows; i++) {
+        for (int j = 0; j < viewCols; j++) {
+            size_t r0 = i * bh;
+            size_t c0 = j * bw;
+            char ch = ' '; // past the end of the grid
+            if (r0 < cfg.height && c0 < cfg.width) {
+                SummaryCounts s;
+                wildfire_tally(sim, r0, c0, r0 + bh < cfg.height ? bh : cfg.height - r0,
+                               c0 + bw < cfg.width ? bw : cfg.width - c0, &s);
+                ch = blockChar(&s);
+            }
+            text[(size_t)i * viewCols + j] = ch;
+        }
+    }
+}
+
+/// Displays a cycle of the simulation. In overlay mode the cycle is handed
+/// to the render thread, which redraws only the cells that changed since
+/// the frame it drew before; a cycle is skipped rather than waited for if
+/// the render thread is behind, except the last one. Only the window or
+/// overview that fits the terminal is filled. In print mode the whole grid
+/// is printed.
+/// @param currCycle the cycle
+/// @param last 1 if no cycle is shown after this one
+
+static void showCycle( int currCycle, int last ) {
+
+    size_t i;
+
+    shownCycle = currCycle;
+    if (print == 0) {
+        RenderFrame *f = render_claim(screen, last);
+        if (f == NULL) {
+            return;
+        }
+        fillView(f->text);
+        int n = snprintf(f->status[0], sizeof f->status[0], "size %zux%zu, pCatch %.2f, density %.2f, pBurning %.2f, pNeighbor %.2f",
+                         cfg.width, cfg.height, cfg.pCatch, cfg.density, cfg.pBurning, cfg.pNeighbor);
+        if (overview == 1) {
+            snprintf(f->status[0] + n, sizeof f->status[0] - n, ", overview");
+        } else if (viewRows < (int)cfg.height || viewCols < (int)cfg.width) {
+            snprintf(f->status[0] + n, sizeof f->status[0] - n, ", window %ld,%ld", viewRow, viewCol);
+        }
+        snprintf(f->status[1], sizeof f->status[1], "cycle %d, changes %ld, cumulative changes %ld",
+                 currCycle, counters.changes, counters.cChanges);
+        render_publish(screen);
+        return;
+    }
+
+    const Grid *g = wildfire_grid(sim);
+    PROF_NOW(shown); // the render thread times overlay mode
+    long bytes = 0; // written, for the profile
+    for (i = 0; i < cfg.height; i++) {
+        rowText(grid_row(g, i), line);
+        bytes += (long) fwrite(line, 1, cfg.width, stdout);
+        if (currCycle == 0 || i != (cfg.height - 1)) {
+            bytes += printf("\n");
+        }
+    }
+    if (currCycle == 0) {
+	bytes += printf("\rsize %zux%zu, pCatch %.2f, density %.2f, pBurning %.2f, pNeighbor %.2f", cfg.width, cfg.height, cfg.pCatch, cfg.density, cfg.pBurning, cfg.pNeighbor);
+        bytes += printf("\ncycle %d, changes %d, cumulative changes %d\n ", 0, 0, 0);
+    } else {
+	bytes += printf(" \n");
+	bytes += printf("\rsize %zux%zu, pCatch %.2f, density %.2f, pBurning %.2f, pNeighbor %.2f", cfg.width, cfg.height, cfg.pCatch, cfg.density, cfg.pBurning, cfg.pNeighbor);
+        bytes += printf("\ncycle %d, changes %ld, cumulative changes %ld \n", currCycle, counters.changes, counters.cChanges);
+    }
+    PROF_COUNT(PROF_BYTES, bytes);
+    PROF_PHASE(PROF_RENDER, shown);
+}
+
+/// Puts the terminal back as it was before startKeys.
+
+static void restoreKeys() {
+    if (panning) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &cooked);
+        panning = 0;
+    }
+}
+
+/// Restores the terminal and dies of the interrupt as it would have.
+/// @param sig the signal
+
+static void interrupted( int sig ) {
+    restoreKeys();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/// Reads keys one at a time and without echo while the overlay display is
+/// on, if the input is a terminal, so that they pan the window.
+
+static void startKeys() {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &cooked) != 0) {
+        return;
+    }
+    struct termios raw = cooked;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0) {
+        panning = 1;
+        atexit(restoreKeys);
+        signal(SIGINT, interrupted);
+        signal(SIGTERM, interrupted);
+    }
+}
+
+/// Moves the window half its size, or switches to or from the overview,
+/// and shows the cycle on display again.
+/// @param key h, j, k or l, or A, B, C or D of an arrow key, or o
+
+static void pan( char key ) {
+    switch (key) {
+    case 'h': case 'D': viewCol -= viewCols / 2; break;
+    case 'l': case 'C': viewCol += viewCols / 2; break;
+    case 'k': case 'A': viewRow -= viewRows / 2; break;
+    case 'j': case 'B': viewRow += viewRows / 2; break;
+    case 'o': overview = !overview; break;
+    default: return;
+    }
+    clampView();
+    showCycle(shownCycle, 0);
+}
+
+/// Waits between cycles. While keys pan the window they are read and
+/// acted on as they come; an arrow key sends ESC [ and a letter, of which
+/// the letter is enough.
+/// @param ms milliseconds to wait
+
+static void idle( long ms ) {
+    if (!panning) {
+        usleep(ms * 1000);
+        return;
+    }
+    double until = seconds() + ms / 1e3;
+    for (;;) {
+        long left = (long)((until - seconds()) * 1e3);
+        struct pollfd in = { .fd = STDIN_FILENO, .events = POLLIN };
+        if (poll(&in, 1, left > 0 ? (int)left : 0) > 0) {
+            char keys[16];
+            ssize_t n = read(STDIN_FILENO, keys, sizeof keys);
+            for (ssize_t k = 0; k < n; k++) {
+                pan(keys[k]);
+            }
+        }
+        if (left <= 0) {
+            return;
+        }
+    }
+}
+
+/// Prints the summary of a headless run.
+/// @param elapsed seconds spent stepping
+/// @param stepped cycles stepped by this run, not counting those before a resume
+
+static void summarize( double elapsed, long stepped ) {
+    long burned = counters.initialTrees - counters.totalTrees;
+    printf("size %zux%zu, pCatch %.2f, density %.2f, pBurning %.2f, pNeighbor %.2f\n", cfg.width, cfg.height, cfg.pCatch, cfg.density, cfg.pBurning, cfg.pNeighbor);
+    // cycles are all cycles stepped, before and after any resume
+    printf("cycles %ld, cumulative changes %ld, burned fraction %.4f, fires %s\n", counters.step, counters.cChanges,
+           counters.initialTrees > 0 ? (double)burned / counters.initialTrees : 0.0, counters.fireTrees == 0 ? "out" : "burning");
+    printf("elapsed %.3f s, %.3g cells/s\n", elapsed,
+           elapsed > 0 ? (double)cfg.width * cfg.height * stepped / elapsed : 0.0);
+}
+
+/// Uses getopt() function to process command line options. 
+/// @param argc length of argv
+/// @param argv array of command strings
+///
+
+int main( int argc, char * argv[] ) {
+
+    int c;
+    int opterr = 0; 
+    long dim = 0; // grid dimension argument
+    int cycleSet = 0; // 1 if -pN limits the number of cycles
+    const char *resumePath = NULL; // checkpoint to continue from
+    const char *landscapePath = NULL; // raster holding cycle 0
+
+    // parameter ranges in percent; ranges are only used in ensemble mode
+    Range burnRange = { 10, 10, 1 };
+    Range catchRange = { 30, 30, 1 };
+    Range densityRange = { 50, 50, 1 };
+    Range neighborRange = { 25, 25, 1 };
+
+    wildfire_defaults(&cfg);
+
+// // // // // // // // // // // // // // // // // // // // // // // // 
+// 
+// If -H, -b, -c, -d, -e, -h, -k, -m, -n, -p, -q, -s, -t, -w or -S are on the command line,
+// getopt will process those arguments. All options except the -H and -q options
+// expect an argument. The long options --checkpoint-every, --checkpoint-file
+// --resume and --landscape are processed by getopt_long along with them.
+//
+// // // // // // // // // // // // // // // // // // // // // // // // 
+
+    while ( (c = getopt_long( argc, argv, "Hb:c:d:e:h:k:m:n:p:qs:t:w:S:", longOptions, NULL) ) != -1 ) { 
+
+    switch ( c ) {
+    case 'H':
+        help();
+	break;
+
+    case 'b':
+	if (ensemble_range( optarg, &burnRange ) == 0 && 0 < burnRange.lo && burnRange.hi < 101) {
+	    cfg.pBurning = (float)burnRange.lo/100;
+	} else {
+	    fprintf( stderr, "(-bN) proportion already burning. must be an integer or range in [1...100].\n");
+	    help();
+	}
+	break;
+
+    case 'c':
+	if (ensemble_range( optarg, &catchRange ) == 0 && 0 < catchRange.lo && catchRange.hi < 101) {
+	    cfg.pCatch = (float)catchRange.lo/100;
+	} else {
+	    fprintf( stderr, "(-cN) probability a tree will catch fire. must be an integer or range in [1...100].\n");
+	    help();
+	}
+	break;
+
+    case 'd':
+	if (ensemble_range( optarg, &densityRange ) == 0 && 0 < densityRange.lo && densityRange.hi < 101) {
+	    cfg.density = (float)densityRange.lo/100;
+	} else {
+	    fprintf( stderr, "(-dN) density of trees in the grid must be an integer or range in [1...100].\n");
+	    help();
+	}
+	break;
+
+    case 'n':
+	if (ensemble_range( optarg, &neighborRange ) == 0 && -1 < neighborRange.lo && neighborRange.hi < 101) {
+	    cfg.pNeighbor = (float)neighborRange.lo/100;
+	} else {
+	    fprintf( stderr, "(-nN) neighbors influence catching fire must be an integer or range in [0...100].\n");
+	    help();
+	}
+	break;
+
+    case 'p':
+	opterr = (int)strtol( optarg, NULL, 10);
+	if (-1 < opterr) {
+	    print = 1;
+	    cycle = (int)opterr;
+	    cycleSet = 1;
+	} else {
+	    fprintf( stderr, "(-pN) number of cycles to print. must be an integer in [0...10000].\n");
+	    help();
+	}
+	break;
+
+    case 'q':
+	quiet = 1;
+	break;
+
+    case 'm':
+	opterr = (int)strtol( optarg, NULL, 10);
+	if (0 < opterr) {
+	    replicates = opterr;
+	} else {
+	    fprintf( stderr, "(-mN) number of runs of every parameter point must be a positive integer.\n");
+	    help();
+	}
+	break;
+
+    case 's':
+	dim = strtol( optarg, NULL, 10);
+	if (4 < dim) {
+	    cfg.width = (size_t)dim;
+	    cfg.height = (size_t)dim;
+	} else {
+	    fprintf( stderr, "(-sN) simulation grid size must be an integer greater than 4.\n");
+	    help();
+	}
+	break;
+
+    case 'k':
+	cfg.kernel = kernel_select( optarg );
+	if (cfg.kernel == NULL) {
+	    fprintf( stderr, "(-kNAME) kernel must be scalar, sse or avx2 and supported by this processor.\n");
+	    help();
+	}
+	break;
+
+    case 't':
+	opterr = (int)strtol( optarg, NULL, 10);
+	if (0 < opterr) {
+	    cfg.threads = opterr;
+	} else {
+	    fprintf( stderr, "(-tN) number of threads must be a positive integer.\n");
+	    help();
+	}
+	break;
+
+    case 'w':
+	dim = strtol( optarg, NULL, 10);
+	if (4 < dim) {
+	    cfg.width = (size_t)dim;
+	} else {
+	    fprintf( stderr, "(-wN) simulation grid width must be an integer greater than 4.\n");
+	    help();
+	}
+	break;
+
+    case 'e':
+	if (strcmp(optarg, "dense") == 0) {
+	    cfg.engine = WILDFIRE_DENSE;
+	} else if (strcmp(optarg, "sparse") == 0) {
+	    cfg.engine = WILDFIRE_SPARSE;
+	} else if (strcmp(optarg, "packed") == 0) {
+	    cfg.engine = WILDFIRE_PACKED;
+	} else if (strcmp(optarg, "tiled") == 0) {
+	    cfg.engine = WILDFIRE_TILED;
+	} else if (strcmp(optarg, "counted") == 0) {
+	    cfg.engine = WILDFIRE_COUNTED;
+	} else {
+	    fprintf( stderr, "(-eNAME) engine must be dense, sparse, packed, tiled or counted.\n");
+	    help();
+	}
+	break;
+
+    case 'h':
+	dim = strtol( optarg, NULL, 10);
+	if (4 < dim) {
+	    cfg.height = (size_t)dim;
+	} else {
+	    fprintf( stderr, "(-hN) simulation grid height must be an integer greater than 4.\n");
+	    help();
+	}
+	break;
+
+    case 'S':
+	if (optarg[0] != '-') {
+	    cfg.seed = strtoul( optarg, NULL, 10);
+	} else {
+	    fprintf( stderr, "(-SN) seed must be a non-negative integer.\n");
+	    help();
+	}
+	break;
+
+    case OPT_CHECKPOINT_EVERY:
+	checkpointEvery = strtol( optarg, NULL, 10);
+	if (checkpointEvery < 1) {
+	    fprintf( stderr, "(--checkpoint-every N) cycles between checkpoints must be a positive integer.\n");
+	    help();
+	}
+	break;
+
+    case OPT_CHECKPOINT_FILE:
+	checkpointPath = optarg;
+	break;
+
+    case OPT_RESUME:
+	resumePath = optarg;
+	break;
+
+    case OPT_LANDSCAPE:
+	landscapePath = optarg;
+	break;
+
+    case OPT_NEIGHBORHOOD:
+	if (strcmp(optarg, "moore") == 0) {
+	    cfg.neighborhood = NEIGHBORHOOD_MOORE;
+	} else if (strcmp(optarg, "von-neumann") == 0) {
+	    cfg.neighborhood = NEIGHBORHOOD_VON_NEUMANN;
+	} else if (strcmp(optarg, "radius2") == 0) {
+	    cfg.neighborhood = NEIGHBORHOOD_RADIUS2;
+	} else {
+	    fprintf( stderr, "(--neighborhood NAME) neighborhood must be moore, von-neumann or radius2.\n");
+	    help();
+	}
+	break;
+
+    case OPT_THRESHOLD:
+	opterr = (int)strtol( optarg, NULL, 10);
+	if (0 < opterr && opterr <= KERNEL_MAX_NEIGHBORS) {
+	    cfg.threshold = opterr;
+	} else {
+	    fprintf( stderr, "(--threshold N) burning neighbors must be an integer in [1...%d].\n", KERNEL_MAX_NEIGHBORS);
+	    help();
+	}
+	break;
+
+    case OPT_TIME_BLOCK:
+	opterr = (int)strtol( optarg, NULL, 10);
+	if (0 < opterr && opterr <= WILDFIRE_TIME_BLOCK_MAX) {
+	    cfg.timeBlock = opterr;
+	} else {
+	    fprintf( stderr, "(--time-block N) cycles must be an integer in [1...%d].\n", WILDFIRE_TIME_BLOCK_MAX);
+	    help();
+	}
+	break;
+
+    case OPT_RECORD:
+	recordPath = optarg;
+	break;
+
+    case OPT_RECORD_KEYS:
+	recordKeys = strtol( optarg, NULL, 10);
+	if (recordKeys < 1) {
+	    fprintf( stderr, "(--record-keys N) cycles between keyframes must be a positive integer.\n");
+	    help();
+	}
+	break;
+
+    case OPT_DELAY:
+	delay = strtol( optarg, NULL, 10);
+	if (delay < 0) {
+	    fprintf( stderr, "(--delay MS) milliseconds between cycles must be a non-negative integer.\n");
+	    help();
+	}
+	break;
+
+    case OPT_WINDOW:
+	if (sscanf(optarg, "%ld,%ld", &viewRow, &viewCol) == 2 && viewRow >= 0 && viewCol >= 0) {
+	    overview = 0;
+	} else {
+	    fprintf( stderr, "(--window ROW,COL) first row and column must be non-negative integers.\n");
+	    help();
+	}
+	break;
+
+    case OPT_OVERVIEW:
+	overview = 1;
+	break;
+
+    case OPT_PROCESSES:
+	opterr = (int)strtol( optarg, NULL, 10);
+	if (0 < opterr) {
+	    processes = opterr;
+	} else {
+	    fprintf( stderr, "(--processes N) number of worker processes must be a positive integer.\n");
+	    help();
+	}
+	break;
+
+    case OPT_FPS:
+	opterr = (int)strtol( optarg, NULL, 10);
+	if (0 < opterr && opterr <= 1000) {
+	    fps = opterr;
+	} else {
+	    fprintf( stderr, "(--fps N) frames a second must be an integer in [1...1000].\n");
+	    help();
+	}
+	break;
+
+    default: 
+	fprintf( stderr, "Bad option causes failure. \n");
+	break;
+    }
+
+
+  }
+	if (replicates > 0 && (checkpointEvery > 0 || resumePath != NULL || landscapePath != NULL
+	                       || recordPath != NULL)) {
+	    fprintf( stderr, "checkpoints, landscapes and trajectories cannot be used in ensemble mode (-mN).\n");
+	    help();
+	}
+
+	if (cfg.neighborhood != NEIGHBORHOOD_MOORE
+	    && (cfg.engine == WILDFIRE_SPARSE || cfg.engine == WILDFIRE_PACKED)) {
+	    fprintf( stderr, "the sparse and packed engines only step the moore neighborhood.\n");
+	    help();
+	}
+
+	if (cfg.timeBlock > 1 && cfg.engine != WILDFIRE_DENSE) {
+	    fprintf( stderr, "--time-block steps the dense engine only.\n");
+	    help();
+	}
+
+	if (processes > 0 && (quiet == 0 || checkpointEvery > 0 || resumePath != NULL || recordPath != NULL
+	                      || replicates > 0)) {
+	    fprintf( stderr, "--processes runs headless (-q), without checkpoints, trajectories or ensembles.\n");
+	    help();
+	}
+
+	if (processes > 0 && (cfg.engine != WILDFIRE_DENSE || cfg.threads > 1)) {
+	    fprintf( stderr, "each worker process steps its subdomain with the dense engine and one thread.\n");
+	    help();
+	}
+
+	if (resumePath != NULL && landscapePath != NULL) {
+	    fprintf( stderr, "a resumed run already has its landscape; --resume and --landscape conflict.\n");
+	    help();
+	}
+
+	if (replicates > 0) {
+	    EnsembleConfig ens = {
+	        .width = cfg.width, .height = cfg.height,
+	        .burning = burnRange, .catching = catchRange,
+	        .density = densityRange, .neighbor = neighborRange,
+	        .replicates = replicates, .workers = cfg.threads, .seed = cfg.seed,
+	        .maxCycles = cycle,
+	        .kernel = cfg.kernel != NULL ? cfg.kernel : kernel_select(NULL),
+	        .hood = cfg.neighborhood, .threshold = cfg.threshold,
+	    };
+	    if (ensemble_run(&ens, stdout) != 0) {
+	        fprintf( stderr, "not enough memory or threads for the ensemble.\n");
+	        return(EXIT_FAILURE);
+	    }
+	    return(EXIT_SUCCESS);
+	}
+
+	if (burnRange.lo != burnRange.hi || catchRange.lo != catchRange.hi
+	    || densityRange.lo != densityRange.hi || neighborRange.lo != neighborRange.hi) {
+	    fprintf( stderr, "parameter ranges can only be used in ensemble mode (-mN).\n");
+	    help();
+	}
+
+	PROF_START();
+	PROF_NOW(initStarted);
+
+	Snapshot saved; // the run continued by --resume
+
+	if (resumePath != NULL) {
+	    // the grid, parameters, seed and counters all come from the checkpoint
+	    cfg.landscape = checkpoint_load(resumePath, &saved);
+	    if (cfg.landscape == NULL) {
+	        fprintf( stderr, "cannot resume from %s: not a checkpoint of this program.\n", resumePath);
+	        return(EXIT_FAILURE);
+	    }
+	    cfg.width = (size_t)saved.width;
+	    cfg.height = (size_t)saved.height;
+	    cfg.seed = (unsigned long)saved.seed;
+	    cfg.pCatch = saved.pCatch;
+	    cfg.density = saved.density;
+	    cfg.pBurning = saved.pBurning;
+	    cfg.pNeighbor = saved.pNeighbor;
+	    if (cycleSet == 0) {
+	        cycle = (int)saved.cycle; // otherwise -pN more cycles are run
+	    }
+	} else if (landscapePath != NULL) {
+	    // the grid size comes from the raster, and density and pBurning from its trees
+	    const char *why = NULL;
+	    long living = 0;
+	    long burning = 0;
+	    cfg.landscape = raster_load(landscapePath, &living, &burning, &why);
+	    if (cfg.landscape == NULL) {
+	        fprintf( stderr, "cannot load landscape %s: %s.\n", landscapePath, why);
+	        return(EXIT_FAILURE);
+	    }
+	    cfg.width = cfg.landscape->width;
+	    cfg.height = cfg.landscape->height;
+	    long trees = living + burning;
+	    cfg.density = (float)((double)trees / (cfg.width * cfg.height));
+	    cfg.pBurning = trees > 0 ? (float)((double)burning / trees) : 0;
+	}
+
+	if (print == 0 && quiet == 0) {
+	    fitView();
+	    // counts per tile are kept for the overview whenever it may be shown
+	    cfg.summary = viewRows < (int)cfg.height || viewCols < (int)cfg.width || overview == 1;
+	}
+
+	if (processes > 0) {
+	    // cycle 0 is built once and split; the workers step and reduce the counters
+	    PROF_PHASE(PROF_INIT, initStarted);
+	    double elapsed;
+	    if (domain_run(&cfg, processes, cycle, &counters, &elapsed) != 0) {
+	        fprintf( stderr, "cannot split a %zu by %zu grid over %d processes: too small, or not enough memory or processes.\n",
+	                 cfg.width, cfg.height, processes);
+	        return(EXIT_FAILURE);
+	    }
+	    summarize(elapsed, counters.step);
+	    return(EXIT_SUCCESS);
+	}
+
+	sim = wildfire_create(&cfg); // places trees at random without a landscape
+	line = malloc(cfg.width + 1);
+	piece = malloc(cfg.width);
+
+	if (sim == NULL || line == NULL || piece == NULL) {
+	    fprintf( stderr, "not enough memory for a %zu by %zu grid.\n", cfg.width, cfg.height);
+	    return(EXIT_FAILURE);
+	}
+
+	if (resumePath != NULL) {
+	    WildfireCounters restored = {
+	        .step = (long)saved.step, .cChanges = (long)saved.cChanges,
+	        .totalTrees = (long)saved.totalTrees, .fireTrees = (long)saved.fireTrees,
+	        .livingTrees = (long)saved.livingTrees, .spaces = (long)saved.spaces,
+	        .initialTrees = (long)saved.initialTrees,
+	    };
+	    wildfire_restore(sim, &restored);
+	}
+	wildfire_query(sim, &counters);
+
+	if (recordPath != NULL) {
+	    RecordInfo info = {
+	        .width = cfg.width, .height = cfg.height, .seed = cfg.seed, .keyEvery = (uint64_t)recordKeys,
+	        .pCatch = cfg.pCatch, .density = cfg.density, .pBurning = cfg.pBurning, .pNeighbor = cfg.pNeighbor,
+	    };
+	    recorder = record_open(recordPath, &info);
+	    if (recorder == NULL) {
+	        fprintf( stderr, "cannot write trajectory %s: %s\n", recordPath, strerror(errno));
+	        return(EXIT_FAILURE);
+	    }
+	    recordCycle(); // the first cycle, which is 0 unless resumed
+	}
+
+	if (print == 0 && quiet == 0) {
+	    screen = render_start(viewRows, viewCols, fps);
+	    if (screen == NULL) {
+	        fprintf( stderr, "not enough memory or threads for the display.\n");
+	        return(EXIT_FAILURE);
+	    }
+	}
+
+	if (print == 1 && quiet == 0) {
+	    printf("%s\n", "============================");
+  	    printf("%s\n", "======== Wildfire ==========");
+  	    printf("%s\n", "============================");
+            printf("==== Print <=  %d Cycles ====\n", cycle);
+            printf("%s\n", "============================");
+	}
+
+	PROF_PHASE(PROF_INIT, initStarted);
+
+	if (quiet == 0) {
+	    if (screen != NULL) {
+	        startKeys();
+	    }
+	    showCycle((int)counters.step, counters.fireTrees == 0 || cycle <= 0);
+	    idle(delay);
+	}
+
+// // // // // // // // // // // // // // // // // // // // // // // // 
+// 
+// The Simulation Loop:
+// The loop continually steps the simulation and checks if
+// all fires are out or the number of cycles has been reached. 
+//
+// // // // // // // // // // // // // // // // // // // // // // // // 
+
+    int currCycle = (int)counters.step + 1; // current cycle of simulation 	
+    long firstStep = counters.step; // cycles stepped before this process started
+    double started = seconds(); // start of the simulation loop
+
+    while(counters.fireTrees > 0 && cycle > 0) {
+	long span = 1; // cycles stepped at once; every one is shown unless quiet
+	if (quiet == 1 && cfg.timeBlock > 1 && recorder == NULL) {
+	    span = cycle; // up to the next checkpoint, if any
+	    if (checkpointEvery > 0 && checkpointEvery - counters.step % checkpointEvery < span) {
+	        span = checkpointEvery - counters.step % checkpointEvery;
+	    }
+	}
+	PROF_NOW(stepped);
+	long done = wildfire_step_n(sim, span);
+	if (done < 0) {
+	    fprintf( stderr, "not enough memory for the fire front.\n");
+	    return(EXIT_FAILURE);
+	}
+	PROF_CYCLE(stepped);
+	wildfire_query(sim, &counters);
+
+	if (quiet == 0) {
+	    showCycle(currCycle, counters.fireTrees == 0 || cycle <= done);
+	}
+	if (recorder != NULL) {
+	    recordCycle();
+	}
+	currCycle += (int)done;
+	cycle -= (int)done;
+
+	if (checkpointEvery > 0 && counters.step % checkpointEvery == 0) {
+	    PROF_NOW(written);
+	    saveCheckpoint();
+	    PROF_PHASE(PROF_CHECKPOINT, written);
+	}
+	PROF_POLL();
+
+	if (quiet == 0) {
+	    idle(delay);
+	}
+    }
+    double elapsed = seconds() - started;
+    render_stop(screen); // the last cycle is on the terminal from here on
+    screen = NULL;
+    restoreKeys();
+
+    if (quiet == 1) {
+	summarize(elapsed, counters.step - firstStep);
+    } else {
+	if (print == 0) {
+	    printf("\n"); // below the status lines
+	}
+	if (counters.fireTrees == 0) {
+          printf("%s\n", "Fires are out.");
+	}
+    }
+
+    if (record_close(recorder) != 0) {
+	fprintf( stderr, "cannot write trajectory %s: %s\n", recordPath, strerror(errno));
+	return(EXIT_FAILURE);
+    }
+    free(line);
+    free(piece);
+    wildfire_destroy(sim);
+
+return(EXIT_SUCCESS);
+
+}
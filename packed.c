@@ -0,0 +1,228 @@
+// file: packed.c
+// Four bits per cell grids stepped sixteen cells at a time.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#include <stdlib.h>
+
+#include "packed.h"
+#include "prof.h"
+#include "rng.h"
+
+#define LANES 16                        ///< cells in a word
+#define LOW 0x1111111111111111ULL       ///< bit 0 of every cell
+
+#define P_EMPTY   0x0 ///< no tree
+#define P_LIVING  0x1 ///< living tree
+#define P_KINDLED 0x3 ///< tree burning at cycle 0
+#define P_BURN0   0x7 ///< tree in its first cycle of burning
+#define P_BURN1   0xb ///< tree in its second cycle of burning
+#define P_BURN2   0xf ///< tree in its third cycle of burning
+#define P_BURNT   0x8 ///< burned out tree
+
+/// A pair of packed grids. Each row has an empty word on either side and
+/// there is an empty row above and below, so every word has neighbors.
+
+struct Packed {
+    size_t width;    // number of cells in a row
+    size_t height;   // number of rows
+    size_t words;    // words in a row, the two empty ones included
+    uint64_t *cur;   // current cycle
+    uint64_t *next;  // next cycle
+};
+
+/// Packed cell of each byte cell state.
+
+static const unsigned char packOf[256] = {
+    [CELL_LIVING] = P_LIVING,
+    [CELL_KINDLED] = P_KINDLED,
+    [CELL_BURN0] = P_BURN0,
+    [CELL_BURN1] = P_BURN1,
+    [CELL_BURN2] = P_BURN2,
+    [CELL_BURNT] = P_BURNT,
+};
+
+/// Byte cell state of each packed cell.
+
+static const cell_t unpackOf[16] = {
+    [P_LIVING] = CELL_LIVING,
+    [P_KINDLED] = CELL_KINDLED,
+    [P_BURN0] = CELL_BURN0,
+    [P_BURN1] = CELL_BURN1,
+    [P_BURN2] = CELL_BURN2,
+    [P_BURNT] = CELL_BURNT,
+};
+
+/// Returns the first word of a row, past its empty word.
+
+static inline uint64_t *row( const Packed *p, uint64_t *cells, size_t r ) {
+    return cells + ( r + 1 ) * p->words + 1;
+}
+
+/// Creates a packed pair of grids, all empty.
+
+Packed *packed_create( size_t width, size_t height ) {
+
+    Packed *p = malloc( sizeof (Packed) );
+    if ( p == NULL ) {
+        return NULL;
+    }
+    p->width = width;
+    p->height = height;
+    p->words = ( width + LANES - 1 ) / LANES + 2;
+
+    size_t count = p->words * ( height + 2 );
+    p->cur = calloc( count, sizeof (uint64_t) );
+    p->next = calloc( count, sizeof (uint64_t) );
+    if ( p->cur == NULL || p->next == NULL ) {
+        packed_destroy( p );
+        return NULL;
+    }
+    return p;
+}
+
+/// Releases a packed pair. NULL is ignored.
+
+void packed_destroy( Packed *p ) {
+    if ( p == NULL ) {
+        return;
+    }
+    free( p->cur );
+    free( p->next );
+    free( p );
+}
+
+/// Packs a byte grid into the current cycle.
+
+void packed_pack( Packed *p, const Grid *g ) {
+    for ( size_t r = 0; r < p->height; r++ ) {
+        const cell_t *in = grid_row( g, r );
+        uint64_t *out = row( p, p->cur, r );
+        for ( size_t c = 0; c < p->width; c += LANES ) {
+            uint64_t w = 0;
+            size_t n = p->width - c < LANES ? p->width - c : LANES;
+            for ( size_t i = 0; i < n; i++ ) {
+                w |= (uint64_t) packOf[in[c + i]] << ( 4 * i );
+            }
+            out[c / LANES] = w;
+        }
+    }
+}
+
+/// Unpacks the current cycle into a byte grid.
+
+void packed_unpack( const Packed *p, Grid *g ) {
+    for ( size_t r = 0; r < p->height; r++ ) {
+        const uint64_t *in = row( p, p->cur, r );
+        cell_t *out = grid_row( g, r );
+        for ( size_t c = 0; c < p->width; c++ ) {
+            out[c] = unpackOf[( in[c / LANES] >> ( 4 * ( c % LANES ) ) ) & 0xf];
+        }
+    }
+}
+
+/// Unpacks cells of one row of the current cycle.
+
+void packed_cells( const Packed *p, size_t r, size_t c, size_t n, cell_t *dst ) {
+    const uint64_t *in = row( p, p->cur, r );
+    for ( size_t j = c; j < c + n; j++ ) {
+        *dst++ = unpackOf[( in[j / LANES] >> ( 4 * ( j % LANES ) ) ) & 0xf];
+    }
+}
+
+/// Adds bit 0 and bit 1 of a word and of its west and east neighbors
+/// (the words shifted by one cell) into per-cell counts of trees and fires.
+
+static inline void triple( const uint64_t *w, uint64_t *trees, uint64_t *fires, int center ) {
+    uint64_t west = ( w[0] << 4 ) | ( w[-1] >> 60 );
+    uint64_t east = ( w[0] >> 4 ) | ( w[1] << 60 );
+    *trees += ( west & LOW ) + ( east & LOW );
+    *fires += ( ( west >> 1 ) & LOW ) + ( ( east >> 1 ) & LOW );
+    if ( center ) {
+        *trees += w[0] & LOW;
+        *fires += ( w[0] >> 1 ) & LOW;
+    }
+}
+
+/// Computes rows [from, to) of the next cycle.
+
+void packed_rows( Packed *p, size_t from, size_t to, const SpreadRule *rule,
+                  uint64_t key, uint64_t limit, Summary *summary, long *ignited, long *burnedOut ) {
+
+    const size_t words = ( p->width + LANES - 1 ) / LANES;
+    long caught = 0;
+    long out = 0;
+    size_t draws = 0;   // counted for the profile only
+    size_t skipped = 0; // cells in words left alone, for the profile
+
+    for ( size_t r = from; r < to; r++ ) {
+        const uint64_t *mid = row( p, p->cur, r );
+        uint64_t *dst = row( p, p->next, r );
+        for ( size_t k = 0; k < words; k++ ) {
+            uint64_t w = mid[k];
+
+            // nothing changes in a word with no fire in or around it
+            const uint64_t *up = mid + k - p->words;
+            const uint64_t *dn = mid + k + p->words;
+            uint64_t around = up[-1] | up[0] | up[1] | mid[k - 1] | w | mid[k + 1]
+                            | dn[-1] | dn[0] | dn[1];
+            if ( ( around & ( LOW << 1 ) ) == 0 ) {
+                dst[k] = w;
+                skipped += k + 1 < words ? LANES : p->width - k * LANES;
+                continue;
+            }
+
+            // every cell's count of tree and burning neighbors, at most 8 each
+            uint64_t trees = 0;
+            uint64_t fires = 0;
+            triple( up, &trees, &fires, 1 );
+            triple( mid + k, &trees, &fires, 0 );
+            triple( dn, &trees, &fires, 1 );
+
+            // burning trees move to the next burn cycle; the third one burns out
+            uint64_t burning = ( w >> 1 ) & LOW;
+            uint64_t last = w & ( w >> 1 ) & ( w >> 2 ) & ( w >> 3 ) & LOW;
+            uint64_t next = w + ( ( burning & ~last ) << 2 );
+            next = ( next & ~( last * 0xf ) ) | ( last << 3 );
+            out += __builtin_popcountll( last );
+
+            // living trees with at least one burning neighbor may catch fire
+            uint64_t living = w & ~( w >> 1 ) & LOW;
+            uint64_t near = ( fires | ( fires >> 1 ) | ( fires >> 2 ) | ( fires >> 3 ) ) & LOW;
+            uint64_t candidates = living & near;
+            while ( candidates ) {
+                int shift = __builtin_ctzll( candidates );
+                unsigned sum = (unsigned)( ( trees >> shift ) & 0xf )
+                             | (unsigned)( ( fires >> shift ) & 0xf ) << 4;
+                if ( rule->spreads[sum] ) {
+                    uint64_t c = (uint64_t) k * LANES + (uint64_t)( shift / 4 );
+                    draws++;
+                    if ( rng_draw( key, (uint64_t) r * p->width + c ) < limit ) {
+                        next |= (uint64_t)( P_BURN0 ^ P_LIVING ) << shift;
+                        caught++;
+                        if ( summary != NULL ) {
+                            summary_ignite( summary, r, (size_t) c );
+                        }
+                    }
+                }
+                candidates &= candidates - 1;
+            }
+
+            dst[k] = next;
+        }
+    }
+
+    PROF_COUNT( PROF_RNG_DRAWS, draws );
+    PROF_COUNT( PROF_EVALUATED, ( to - from ) * p->width - skipped );
+    PROF_COUNT( PROF_SKIPPED, skipped );
+    *ignited = caught;
+    *burnedOut = out;
+}
+
+/// Makes the next cycle current.
+
+void packed_swap( Packed *p ) {
+    uint64_t *tmp = p->cur;
+    p->cur = p->next;
+    p->next = tmp;
+}
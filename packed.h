@@ -0,0 +1,101 @@
+/*
+ * File:    packed.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Bit-packed grid storage with word-parallel (SWAR) stepping. A cell
+ * has seven states, so it needs at least three bits; cells are stored
+ * four bits each, sixteen to a 64 bit word, half the size of the byte
+ * grid. Bit 0 of a cell is set for any tree, bit 1 for a burning tree
+ * and bits 2 and 3 hold the burn cycle, or bit 3 alone marks a burned
+ * out tree:
+ *
+ *      empty 0000  living 0001  kindled 0011  burning 0111 1011 1111
+ *      burnt 1000
+ *
+ *      One step reads a word and its neighbors in the rows above and
+ * below and computes all sixteen cells at once: the number of tree and
+ * burning neighbors of every cell is added up lane by lane, burning
+ * trees advance their burn cycle with one addition, and only the living
+ * trees with a burning neighbor are looked at one by one to apply the
+ * spread rule and draw for catching fire. Draws are keyed exactly as in
+ * the byte engines, so the result is the same cell for cell.
+ *
+ */
+
+#ifndef WILDFIRE_PACKED_H
+#define WILDFIRE_PACKED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "kernel.h"
+#include "summary.h"
+
+/// Opaque pair of packed grids: the current cycle and the next one.
+///
+typedef struct Packed Packed;
+
+/// Creates a packed pair of grids of the given dimensions, all empty.
+///
+/// @param width: number of cells in a row
+/// @param height: number of rows
+/// @return the pair, or NULL if memory could not be obtained
+///
+Packed *packed_create( size_t width, size_t height );
+
+/// Releases a packed pair. NULL is ignored.
+///
+/// @param p: the pair
+///
+void packed_destroy( Packed *p );
+
+/// Packs a byte grid of the same dimensions into the current cycle.
+///
+/// @param p: the pair
+/// @param g: grid to be packed
+///
+void packed_pack( Packed *p, const Grid *g );
+
+/// Unpacks the current cycle into a byte grid of the same dimensions.
+///
+/// @param p: the pair
+/// @param g: grid to be overwritten
+///
+void packed_unpack( const Packed *p, Grid *g );
+
+/// Unpacks cells of one row of the current cycle.
+///
+/// @param p: the pair
+/// @param r: the row
+/// @param c: first column
+/// @param n: number of cells, all in the grid
+/// @param dst: receives the cells
+///
+void packed_cells( const Packed *p, size_t r, size_t c, size_t n, cell_t *dst );
+
+/// Computes rows [from, to) of the next cycle from the current one.
+/// Bands of rows may be stepped by different threads at once.
+///
+/// @param p: the pair
+/// @param from: first row
+/// @param to: one past the last row
+/// @param rule: neighbor sums that spread fire
+/// @param key: key of the random stream of this cycle
+/// @param limit: a draw under this limit catches fire
+/// @param summary: told of every tree that catches fire; NULL for none
+/// @param ignited: receives the number of trees that caught fire
+/// @param burnedOut: receives the number of trees that burned out
+///
+void packed_rows( Packed *p, size_t from, size_t to, const SpreadRule *rule,
+                  uint64_t key, uint64_t limit, Summary *summary, long *ignited, long *burnedOut );
+
+/// Makes the next cycle current, once all its rows are computed.
+///
+/// @param p: the pair
+///
+void packed_swap( Packed *p );
+
+#endif
@@ -0,0 +1,143 @@
+// file: prof.c
+// Phase timers, step latency histogram and counters, written as JSON.
+// Empty unless compiled with -DWILDFIRE_PROF.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers; sigaction
+
+#include "prof.h"
+
+#ifdef WILDFIRE_PROF
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h> // clock_gettime
+
+#define BUCKETS 64 ///< bucket i holds latencies in [2^i, 2^(i+1)) ns
+
+static const char *phaseNames[PROF_PHASES] = { "init", "step", "render", "checkpoint", "record" };
+
+static const char *counterNames[PROF_COUNTERS] = {
+    "rng_draws", "cells_evaluated", "cells_skipped", "bytes_written", "frames_dropped"
+};
+
+static uint64_t phaseNs[PROF_PHASES]; // time spent in each phase
+static uint64_t phaseCalls[PROF_PHASES]; // passes through each phase
+static uint64_t counters[PROF_COUNTERS]; // added to atomically
+static uint64_t histogram[BUCKETS]; // step latencies
+static uint64_t fastest = UINT64_MAX; // shortest step
+static uint64_t slowest = 0; // longest step
+static uint64_t started = 0; // time of prof_start
+
+static volatile sig_atomic_t requested = 0; // 1 once SIGUSR1 arrives
+
+/// Notes that the record was asked for; it is written by prof_poll.
+
+static void onSignal( int sig ) {
+    (void) sig;
+    requested = 1;
+}
+
+/// Writes the record as one JSON object.
+
+static void dump( FILE *out ) {
+
+    fprintf( out, "{\n  \"elapsed_s\": %.6f,\n  \"phases\": {", ( prof_now() - started ) / 1e9 );
+    for ( int p = 0; p < PROF_PHASES; p++ ) {
+        fprintf( out, "%s\n    \"%s\": { \"seconds\": %.6f, \"calls\": %llu }", p ? "," : "",
+                 phaseNames[p], phaseNs[p] / 1e9, (unsigned long long) phaseCalls[p] );
+    }
+
+    uint64_t steps = phaseCalls[PROF_STEP];
+    fprintf( out, "\n  },\n  \"step_latency_ns\": {\n    \"count\": %llu, \"min\": %llu, "
+                  "\"max\": %llu, \"mean\": %.0f,\n    \"buckets\": [",
+             (unsigned long long) steps, (unsigned long long)( steps ? fastest : 0 ),
+             (unsigned long long) slowest, steps ? (double) phaseNs[PROF_STEP] / steps : 0.0 );
+    int first = 1;
+    for ( int b = 0; b < BUCKETS; b++ ) {
+        if ( histogram[b] > 0 ) {
+            fprintf( out, "%s\n      { \"lo\": %llu, \"hi\": %llu, \"count\": %llu }",
+                     first ? "" : ",", 1ULL << b, b < 63 ? 1ULL << ( b + 1 ) : UINT64_MAX,
+                     (unsigned long long) histogram[b] );
+            first = 0;
+        }
+    }
+
+    fprintf( out, "\n    ]\n  },\n  \"counters\": {" );
+    for ( int c = 0; c < PROF_COUNTERS; c++ ) {
+        fprintf( out, "%s\n    \"%s\": %llu", c ? "," : "", counterNames[c],
+                 (unsigned long long) __atomic_load_n( &counters[c], __ATOMIC_RELAXED ) );
+    }
+    fprintf( out, "\n  }\n}\n" );
+}
+
+/// Writes the record to WILDFIRE_PROF_FILE, or to stderr.
+
+static void report() {
+    const char *path = getenv( "WILDFIRE_PROF_FILE" );
+    FILE *out = path ? fopen( path, "w" ) : stderr;
+    if ( out == NULL ) {
+        perror( path );
+        return;
+    }
+    dump( out );
+    if ( out != stderr ) {
+        fclose( out );
+    } else {
+        fflush( out );
+    }
+}
+
+/// Starts recording: the record is written at exit and on SIGUSR1.
+
+void prof_start() {
+    struct sigaction sa = { .sa_handler = onSignal };
+    sigemptyset( &sa.sa_mask );
+    sa.sa_flags = SA_RESTART;
+    sigaction( SIGUSR1, &sa, NULL );
+    started = prof_now();
+    atexit( report );
+}
+
+/// Reads the monotonic clock in nanoseconds.
+
+uint64_t prof_now() {
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+/// Adds the time of one pass through a phase.
+
+void prof_phase( ProfPhase phase, uint64_t ns ) {
+    phaseNs[phase] += ns;
+    phaseCalls[phase]++;
+}
+
+/// Adds the time of one step to the step phase and the latency histogram.
+
+void prof_cycle( uint64_t ns ) {
+    prof_phase( PROF_STEP, ns );
+    histogram[ns ? 63 - __builtin_clzll( ns ) : 0]++;
+    fastest = ns < fastest ? ns : fastest;
+    slowest = ns > slowest ? ns : slowest;
+}
+
+/// Adds to a counter from any thread.
+
+void prof_count( ProfCounter counter, uint64_t n ) {
+    __atomic_fetch_add( &counters[counter], n, __ATOMIC_RELAXED );
+}
+
+/// Writes the record if SIGUSR1 arrived since the last call.
+
+void prof_poll() {
+    if ( requested ) {
+        requested = 0;
+        report();
+    }
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * File:    prof.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Optional instrumentation of the hot paths. When the program is
+ * compiled with -DWILDFIRE_PROF, the PROF_ macros below record the time
+ * spent in each phase of a run (initialization, stepping, rendering,
+ * checkpoints), a histogram of the latency of each step, and counters
+ * of random draws, cells evaluated and skipped by the engines, and
+ * bytes written to the terminal. The record is written as JSON when
+ * the program exits, and whenever it receives SIGUSR1, to the file
+ * named by the WILDFIRE_PROF_FILE environment variable or else to
+ * stderr.
+ *      Without -DWILDFIRE_PROF the macros compile to nothing, and
+ * prof.c is empty, so the hot paths carry no cost. Counters are added
+ * once per row or per band, never per cell, and atomically, so band
+ * threads may count at the same time.
+ *
+ */
+
+#ifndef WILDFIRE_PROF_H
+#define WILDFIRE_PROF_H
+
+#include <stdint.h>
+
+/// Phases of a run that are timed.
+///
+typedef enum {
+    PROF_INIT,       ///< building cycle 0: allocation, placement, loading
+    PROF_STEP,       ///< computing the next cycle
+    PROF_RENDER,     ///< displaying a cycle
+    PROF_CHECKPOINT, ///< writing a checkpoint
+    PROF_RECORD,     ///< recording a cycle in a trajectory
+    PROF_PHASES
+} ProfPhase;
+
+/// Events that are counted.
+///
+typedef enum {
+    PROF_RNG_DRAWS,  ///< random numbers drawn
+    PROF_EVALUATED,  ///< cells whose next state was computed
+    PROF_SKIPPED,    ///< cells left alone by an engine because nothing near them burns
+    PROF_BYTES,      ///< bytes written to the terminal
+    PROF_DROPPED,    ///< frames of the overlay display skipped
+    PROF_COUNTERS
+} ProfCounter;
+
+#ifdef WILDFIRE_PROF
+
+/// Starts recording: the record is written at exit and on SIGUSR1.
+///
+void prof_start();
+
+/// Reads the monotonic clock.
+///
+/// @return nanoseconds since an arbitrary point in the past
+///
+uint64_t prof_now();
+
+/// Adds the time of one pass through a phase.
+///
+/// @param phase: the phase
+/// @param ns: nanoseconds spent
+///
+void prof_phase( ProfPhase phase, uint64_t ns );
+
+/// Adds the time of one step to the step phase and to the histogram of
+/// step latencies.
+///
+/// @param ns: nanoseconds spent
+///
+void prof_cycle( uint64_t ns );
+
+/// Adds to a counter. Safe to call from any thread.
+///
+/// @param counter: the counter
+/// @param n: amount to add
+///
+void prof_count( ProfCounter counter, uint64_t n );
+
+/// Writes the record if SIGUSR1 arrived since the last call. Called by
+/// the main loop once a cycle, where writing is safe.
+///
+void prof_poll();
+
+#define PROF_START() prof_start()
+#define PROF_NOW(t) uint64_t t = prof_now()
+#define PROF_PHASE(phase, since) prof_phase( (phase), prof_now() - (since) )
+#define PROF_CYCLE(since) prof_cycle( prof_now() - (since) )
+#define PROF_COUNT(counter, n) prof_count( (counter), (uint64_t)(n) )
+#define PROF_POLL() prof_poll()
+
+#else
+
+#define PROF_START() ( (void) 0 )
+#define PROF_NOW(t) ( (void) 0 )
+#define PROF_PHASE(phase, since) ( (void) 0 )
+#define PROF_CYCLE(since) ( (void) 0 )
+#define PROF_COUNT(counter, n) ( (void)(n) )
+#define PROF_POLL() ( (void) 0 )
+
+#endif
+
+#endif
@@ -0,0 +1,307 @@
+// file: raster.c
+// Streaming loader of initial landscapes from PGM and ESRI ASCII grid rasters.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers; getc_unlocked, fseeko, madvise
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h> // strcasecmp
+#include <sys/mman.h> // mmap, madvise, munmap
+#include <sys/stat.h> // fstat
+
+#include "raster.h"
+
+#define RASTER_BUFFER ( 1 << 20 ) ///< stdio buffer for text rasters
+#define RASTER_TOKEN 64           ///< longest word or number in a raster
+#define RASTER_FIRE 2             ///< ASCII grid value of a burning tree
+
+/// Reads the next word of a text raster, skipping white space and PGM
+/// comments. The white space character ending the word is consumed.
+/// @return length of the word, 0 at the end of the file, -1 if too long
+
+static int word( FILE *f, char *buf ) {
+
+    int ch = getc_unlocked( f );
+    for (;;) {
+        while ( ch != EOF && isspace( ch ) ) {
+            ch = getc_unlocked( f );
+        }
+        if ( ch != '#' ) {
+            break;
+        }
+        while ( ch != EOF && ch != '\n' ) {
+            ch = getc_unlocked( f );
+        }
+    }
+
+    int n = 0;
+    while ( ch != EOF && !isspace( ch ) ) {
+        if ( n == RASTER_TOKEN - 1 ) {
+            return -1;
+        }
+        buf[n++] = (char) ch;
+        ch = getc_unlocked( f );
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+/// Converts a word to a number. Plain integers, by far the most common,
+/// are converted without strtod.
+/// @return 0 on success, -1 if the word is not a number
+
+static int number( const char *text, double *value ) {
+
+    const char *p = text;
+    int negative = ( *p == '-' );
+    if ( negative ) {
+        p++;
+    }
+    long n = 0;
+    while ( *p >= '0' && *p <= '9' && n < 100000000 ) {
+        n = n * 10 + ( *p++ - '0' );
+    }
+    if ( *p == '\0' && p != text + negative ) {
+        *value = negative ? -n : n;
+        return 0;
+    }
+
+    char *end;
+    *value = strtod( text, &end );
+    return ( end != text && *end == '\0' ) ? 0 : -1;
+}
+
+/// Reads the next word of a text raster as a number.
+/// @return 0 on success, -1 at the end of the file or if it is not a number
+
+static int next( FILE *f, double *value ) {
+    char buf[RASTER_TOKEN];
+    if ( word( f, buf ) <= 0 ) {
+        return -1;
+    }
+    return number( buf, value );
+}
+
+/// Reads a dimension of a raster.
+/// @return the dimension, or 0 if it is not a positive integer
+
+static size_t dimension( FILE *f ) {
+    double v;
+    if ( next( f, &v ) != 0 || v < 1 || v > (double) SIZE_MAX || v != (size_t) v ) {
+        return 0;
+    }
+    return (size_t) v;
+}
+
+/// Cell of a PGM pixel: black is empty, white is burning, gray is living.
+
+static inline cell_t pgmCell( unsigned v, unsigned maxval ) {
+    return v == 0 ? CELL_EMPTY : v >= maxval ? CELL_KINDLED : CELL_LIVING;
+}
+
+/// Cell of an ASCII grid value: nothing is empty, 2 is burning, any other
+/// fuel class is living.
+
+static inline cell_t gridCell( double v, int hasNodata, double nodata ) {
+    if ( v <= 0 || ( hasNodata && v == nodata ) ) {
+        return CELL_EMPTY;
+    }
+    return v == RASTER_FIRE ? CELL_KINDLED : CELL_LIVING;
+}
+
+/// Adds a cell to the counts of trees.
+
+static inline void count( cell_t cell, long *living, long *burning ) {
+    *living += ( cell == CELL_LIVING );
+    *burning += ( cell == CELL_KINDLED );
+}
+
+/// Reads the text pixels of a plain PGM into a grid.
+/// @return 0 on success, -1 with why set otherwise
+
+static int readPlain( FILE *f, Grid *g, unsigned maxval, long *living, long *burning,
+                      const char **why ) {
+    for ( size_t r = 0; r < g->height; r++ ) {
+        cell_t *row = grid_row( g, r );
+        for ( size_t c = 0; c < g->width; c++ ) {
+            double v;
+            if ( next( f, &v ) != 0 || v < 0 || v > maxval ) {
+                *why = "missing or bad pixel value";
+                return -1;
+            }
+            row[c] = pgmCell( (unsigned) v, maxval );
+            count( row[c], living, burning );
+        }
+    }
+    return 0;
+}
+
+/// Converts the pixels of a binary PGM into a grid. The pixels are mapped
+/// from the file and read once, in order, so the kernel can read ahead
+/// and drop pages behind.
+/// @return 0 on success, -1 with why set otherwise
+
+static int readBinary( FILE *f, Grid *g, unsigned maxval, long *living, long *burning,
+                       const char **why ) {
+
+    size_t depth = maxval > 255 ? 2 : 1; // bytes per pixel
+    off_t start = ftello( f );
+    struct stat st;
+    if ( start < 0 || fstat( fileno( f ), &st ) != 0 ) {
+        *why = "cannot find the pixels";
+        return -1;
+    }
+    if ( g->width > SIZE_MAX / depth / g->height
+         || (uint64_t) st.st_size - (uint64_t) start < (uint64_t) g->width * g->height * depth ) {
+        *why = "file is shorter than its pixels";
+        return -1;
+    }
+
+    size_t length = (size_t) st.st_size;
+    const unsigned char *file = mmap( NULL, length, PROT_READ, MAP_PRIVATE, fileno( f ), 0 );
+    if ( file == MAP_FAILED ) {
+        *why = "cannot map the pixels";
+        return -1;
+    }
+    madvise( (void *) file, length, MADV_SEQUENTIAL );
+
+    const unsigned char *p = file + start;
+    for ( size_t r = 0; r < g->height; r++ ) {
+        cell_t *row = grid_row( g, r );
+        if ( depth == 1 ) {
+            for ( size_t c = 0; c < g->width; c++ ) {
+                row[c] = pgmCell( p[c], maxval );
+                count( row[c], living, burning );
+            }
+        } else {
+            for ( size_t c = 0; c < g->width; c++ ) {
+                row[c] = pgmCell( (unsigned) p[2 * c] << 8 | p[2 * c + 1], maxval );
+                count( row[c], living, burning );
+            }
+        }
+        p += g->width * depth;
+    }
+
+    munmap( (void *) file, length );
+    return 0;
+}
+
+/// Loads a PGM after its magic number.
+/// @return the grid, or NULL with why set
+
+static Grid *loadPgm( FILE *f, int binary, long *living, long *burning, const char **why ) {
+
+    size_t width = dimension( f );
+    size_t height = dimension( f );
+    double maxval;
+    if ( width == 0 || height == 0 || next( f, &maxval ) != 0 || maxval < 1 || maxval > 65535 ) {
+        *why = "bad PGM header";
+        return NULL;
+    }
+
+    Grid *g = grid_create( width, height );
+    if ( g == NULL ) {
+        *why = "not enough memory for the grid";
+        return NULL;
+    }
+
+    int status = binary ? readBinary( f, g, (unsigned) maxval, living, burning, why )
+                        : readPlain( f, g, (unsigned) maxval, living, burning, why );
+    if ( status != 0 ) {
+        grid_destroy( g );
+        return NULL;
+    }
+    return g;
+}
+
+/// Loads an ESRI ASCII grid whose first header word has been read.
+/// @return the grid, or NULL with why set
+
+static Grid *loadAsciiGrid( FILE *f, char *buf, long *living, long *burning, const char **why ) {
+
+    size_t width = 0;
+    size_t height = 0;
+    int hasNodata = 0;
+    double nodata = 0;
+    double v;
+
+    // header lines are a keyword and a number; the first number alone starts the values
+    while ( isalpha( (unsigned char) buf[0] ) ) {
+        if ( strcasecmp( buf, "ncols" ) == 0 ) {
+            width = dimension( f );
+        } else if ( strcasecmp( buf, "nrows" ) == 0 ) {
+            height = dimension( f );
+        } else if ( strcasecmp( buf, "nodata_value" ) == 0 ) {
+            hasNodata = ( next( f, &nodata ) == 0 );
+        } else if ( next( f, &v ) != 0 ) { // corners and cell size are not used
+            *why = "bad ASCII grid header";
+            return NULL;
+        }
+        if ( word( f, buf ) <= 0 ) {
+            break;
+        }
+    }
+    if ( width == 0 || height == 0 ) {
+        *why = "ASCII grid header lacks ncols or nrows";
+        return NULL;
+    }
+
+    Grid *g = grid_create( width, height );
+    if ( g == NULL ) {
+        *why = "not enough memory for the grid";
+        return NULL;
+    }
+
+    for ( size_t r = 0; r < height; r++ ) {
+        cell_t *row = grid_row( g, r );
+        for ( size_t c = 0; c < width; c++ ) {
+            // buf holds the first value when the header ends
+            if ( ( r > 0 || c > 0 ) && word( f, buf ) <= 0 ) {
+                buf[0] = '\0';
+            }
+            if ( number( buf, &v ) != 0 ) {
+                *why = "missing or bad grid value";
+                grid_destroy( g );
+                return NULL;
+            }
+            row[c] = gridCell( v, hasNodata, nodata );
+            count( row[c], living, burning );
+        }
+    }
+    return g;
+}
+
+/// Loads a grid from a PGM or ESRI ASCII grid file.
+
+Grid *raster_load( const char *path, long *living, long *burning, const char **why ) {
+
+    FILE *f = fopen( path, "rb" );
+    if ( f == NULL ) {
+        *why = "cannot open the file";
+        return NULL;
+    }
+    setvbuf( f, NULL, _IOFBF, RASTER_BUFFER );
+
+    *living = 0;
+    *burning = 0;
+
+    char buf[RASTER_TOKEN];
+    Grid *g = NULL;
+    if ( word( f, buf ) <= 0 ) {
+        *why = "empty file";
+    } else if ( strcmp( buf, "P2" ) == 0 || strcmp( buf, "P5" ) == 0 ) {
+        g = loadPgm( f, buf[1] == '5', living, burning, why );
+    } else if ( strcasecmp( buf, "ncols" ) == 0 || strcasecmp( buf, "nrows" ) == 0 ) {
+        g = loadAsciiGrid( f, buf, living, burning, why );
+    } else {
+        *why = "not a PGM or ESRI ASCII grid";
+    }
+
+    fclose( f );
+    return g;
+}
@@ -0,0 +1,45 @@
+/*
+ * File:    raster.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Loads the initial landscape of a simulation from a raster file
+ * instead of placing trees at random. Three formats are read, told
+ * apart by their first bytes:
+ *
+ *      P2  plain PGM: a text header and pixel values in text.
+ *      P5  binary PGM: a text header and one pixel per byte (two bytes,
+ *          most significant first, when maxval is above 255). The pixels
+ *          are mapped from the file with mmap, not read.
+ *      ncols ...  ESRI ASCII grid: ncols, nrows, xllcorner, yllcorner,
+ *          cellsize and an optional NODATA_value, then values in text.
+ *
+ *      In a PGM, black (0) is empty, white (maxval) is a burning tree and
+ * every gray is a living tree. In an ASCII grid, 0, NODATA and negative
+ * values are empty, 2 is a burning tree and any other value (a fuel
+ * class) is a living tree. The first row of the file is the top row of
+ * the grid.
+ *      Values are converted to cells as they are read, straight into the
+ * grid, so a file of any size is loaded with no copy besides the grid.
+ *
+ */
+
+#ifndef WILDFIRE_RASTER_H
+#define WILDFIRE_RASTER_H
+
+#include "grid.h"
+
+/// Loads a grid from a raster file.
+///
+/// @param path: name of the file
+/// @param living: receives the number of living trees
+/// @param burning: receives the number of burning trees
+/// @param why: receives a description of the problem if the file
+///             cannot be loaded
+/// @return the grid, sized to the raster, or NULL if the file could
+///         not be read, is not a raster or memory ran out
+///
+Grid *raster_load( const char *path, long *living, long *burning, const char **why );
+
+#endif
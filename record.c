@@ -0,0 +1,506 @@
+// file: record.c
+// Binary trajectories: keyframes and run-length encoded deltas of every
+// cycle, written through a large buffer and read back from any cycle.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers; fseeko, ftello
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // memcmp, memcpy
+#include <sys/stat.h> // fstat
+
+#include "record.h"
+
+#define RECORD_MAGIC "WILDTRAJ" ///< first 8 bytes of every trajectory
+#define RECORD_VERSION 1        ///< layout of the header and the frames
+#define RECORD_ORDER 0x01020304 ///< reads back differently on another byte order
+#define RECORD_BUFFER (1 << 20) ///< bytes collected before the file is written
+
+#define FRAME_KEY 1   ///< the whole grid, as runs (length, state)
+#define FRAME_DELTA 2 ///< the cells changed, as runs (gap, length, state)
+
+#define VARINT_MAX 10 ///< longest varint of 64 bits
+#define RUN_MAX ( 2 * VARINT_MAX + 1 ) ///< longest encoded run
+
+/// First bytes of a trajectory file. The frames follow.
+
+typedef struct {
+    char magic[8];    // RECORD_MAGIC, not terminated
+    uint32_t version; // RECORD_VERSION
+    uint32_t order;   // RECORD_ORDER
+    RecordInfo info;  // size and parameters of the run
+} Header;
+
+/// First bytes of a frame. The encoded cells follow.
+
+typedef struct {
+    uint64_t cycle;   // cycle of the frame
+    uint32_t kind;    // FRAME_KEY or FRAME_DELTA
+    uint32_t unused;  // 0
+    uint64_t changes; // cells changed since the cycle before
+    uint64_t bytes;   // length of the encoded cells
+} FrameHeader;
+
+struct Recorder {
+    FILE *file;          // the trajectory
+    RecordInfo info;     // size and parameters of the run
+    cell_t *prev;        // cells of the cycle recorded last, row by row
+    unsigned char *code; // encoded cells of the frame being written
+    size_t used;         // bytes in code
+    size_t capacity;     // room in code
+    uint64_t next;       // cycle expected next
+    int started;         // 1 once a cycle is recorded
+};
+
+struct Trajectory {
+    FILE *file;          // the trajectory
+    RecordInfo info;     // size and parameters of the run
+    uint64_t first;      // first cycle
+    uint64_t cycles;     // number of complete frames
+    off_t *keys;         // offset of each keyframe
+    uint64_t *keyCycles; // cycle of each keyframe, increasing
+    size_t keyCount;     // number of keyframes
+    cell_t *cells;       // cells of the cycle decoded last, row by row
+    int decoded;         // 1 once a cycle is decoded
+    uint64_t at;         // cycle decoded last
+    uint64_t changes;    // cells it changed
+    off_t after;         // offset of the frame after it
+    unsigned char *code; // encoded cells of the frame being read
+    size_t capacity;     // room in code
+};
+
+/// Makes room for at least need more bytes of encoded cells.
+/// @return 0 on success, -1 if memory could not be obtained
+
+static int reserve( unsigned char **code, size_t *capacity, size_t need ) {
+    if ( need <= *capacity ) {
+        return 0;
+    }
+    size_t room = *capacity ? *capacity : RECORD_BUFFER;
+    while ( room < need ) {
+        room *= 2;
+    }
+    unsigned char *p = realloc( *code, room );
+    if ( p == NULL ) {
+        return -1;
+    }
+    *code = p;
+    *capacity = room;
+    return 0;
+}
+
+/// Appends an unsigned LEB128 varint; room must have been reserved.
+/// @return the position after it
+
+static unsigned char *putVarint( unsigned char *p, uint64_t v ) {
+    while ( v >= 0x80 ) {
+        *p++ = (unsigned char)( v | 0x80 );
+        v >>= 7;
+    }
+    *p++ = (unsigned char) v;
+    return p;
+}
+
+/// Reads an unsigned LEB128 varint that must end before end.
+/// @return the position after it, or NULL if it does not
+
+static const unsigned char *getVarint( const unsigned char *p, const unsigned char *end,
+                                       uint64_t *v ) {
+    *v = 0;
+    for ( int shift = 0; p < end && shift < 64; shift += 7 ) {
+        *v |= (uint64_t)( *p & 0x7f ) << shift;
+        if ( !( *p++ & 0x80 ) ) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/// Creates a trajectory file.
+
+Recorder *record_open( const char *path, const RecordInfo *info ) {
+
+    Recorder *r = calloc( 1, sizeof (Recorder) );
+    if ( r == NULL ) {
+        return NULL;
+    }
+    r->info = *info;
+    r->info.keyEvery = info->keyEvery > 0 ? info->keyEvery : 1;
+    r->prev = malloc( info->width * info->height );
+    r->file = fopen( path, "wb" );
+    if ( r->prev == NULL || r->file == NULL ) {
+        int saved = errno;
+        record_close( r );
+        errno = saved;
+        return NULL;
+    }
+    setvbuf( r->file, NULL, _IOFBF, RECORD_BUFFER );
+
+    Header h = { .version = RECORD_VERSION, .order = RECORD_ORDER, .info = r->info };
+    memcpy( h.magic, RECORD_MAGIC, sizeof h.magic );
+    if ( fwrite( &h, sizeof h, 1, r->file ) != 1 ) {
+        int saved = errno;
+        record_close( r );
+        errno = saved;
+        return NULL;
+    }
+    return r;
+}
+
+/// Makes room in r->code for the runs of one more row after p.
+/// @return the position of p after the room is made, or NULL if memory
+///         could not be obtained
+
+static unsigned char *roomForRow( Recorder *r, unsigned char *p ) {
+    size_t used = (size_t)( p - r->code );
+    if ( reserve( &r->code, &r->capacity, used + ( r->info.width + 1 ) * RUN_MAX ) != 0 ) {
+        return NULL;
+    }
+    return r->code + used;
+}
+
+/// Encodes a whole grid as runs (length, state) into r->code, and copies
+/// it into r->prev.
+/// @param changes receives the number of cells that differ from r->prev
+/// @return 0 on success, -1 if memory could not be obtained
+
+static int encodeKey( Recorder *r, const Grid *g, uint64_t *changes ) {
+
+    *changes = 0;
+    unsigned char *p = r->code;
+    uint64_t length = 0; // cells in the current run
+    cell_t state = CELL_EMPTY; // state of the current run
+
+    for ( size_t i = 0; i < g->height; i++ ) {
+        if ( ( p = roomForRow( r, p ) ) == NULL ) {
+            return -1;
+        }
+        const cell_t *row = grid_row( g, i );
+        cell_t *prev = r->prev + i * g->width;
+        for ( size_t j = 0; j < g->width; j++ ) {
+            *changes += row[j] != prev[j];
+            if ( length > 0 && row[j] == state ) {
+                length++;
+                continue;
+            }
+            if ( length > 0 ) {
+                p = putVarint( p, length );
+                *p++ = state;
+            }
+            state = row[j];
+            length = 1;
+        }
+        memcpy( prev, row, g->width );
+    }
+    if ( length > 0 ) {
+        p = putVarint( p, length );
+        *p++ = state;
+    }
+    r->used = (size_t)( p - r->code );
+    return 0;
+}
+
+/// Encodes the cells of a grid that differ from r->prev as runs (gap,
+/// length, state) into r->code, and updates r->prev. Rows that did not
+/// change are skipped whole.
+/// @param changes receives the number of cells that changed
+/// @return 0 on success, -1 if memory could not be obtained
+
+static int encodeDelta( Recorder *r, const Grid *g, uint64_t *changes ) {
+
+    *changes = 0;
+    unsigned char *p = r->code;
+    uint64_t gap = 0; // unchanged cells since the current run started
+    uint64_t runGap = 0; // unchanged cells before the current run
+    uint64_t length = 0; // cells in the current run
+    cell_t state = CELL_EMPTY; // state of the current run
+
+    for ( size_t i = 0; i < g->height; i++ ) {
+        const cell_t *row = grid_row( g, i );
+        cell_t *prev = r->prev + i * g->width;
+        if ( memcmp( row, prev, g->width ) == 0 ) {
+            if ( length > 0 ) {
+                p = putVarint( putVarint( p, runGap ), length );
+                *p++ = state;
+                length = 0;
+            }
+            gap += g->width;
+            continue;
+        }
+        if ( ( p = roomForRow( r, p ) ) == NULL ) {
+            return -1;
+        }
+        for ( size_t j = 0; j < g->width; j++ ) {
+            if ( length == 0 ) {
+                // between runs, unchanged cells are skipped a word at a time
+                uint64_t a, b;
+                while ( j + sizeof a <= g->width ) {
+                    memcpy( &a, row + j, sizeof a );
+                    memcpy( &b, prev + j, sizeof b );
+                    if ( a != b ) {
+                        break;
+                    }
+                    gap += sizeof a;
+                    j += sizeof a;
+                }
+                if ( j == g->width ) {
+                    break;
+                }
+            }
+            if ( row[j] == prev[j] ) {
+                if ( length > 0 ) {
+                    p = putVarint( putVarint( p, runGap ), length );
+                    *p++ = state;
+                    length = 0;
+                }
+                gap++;
+                continue;
+            }
+            (*changes)++;
+            prev[j] = row[j];
+            if ( length > 0 && row[j] == state ) {
+                length++;
+                continue;
+            }
+            if ( length > 0 ) {
+                p = putVarint( putVarint( p, runGap ), length );
+                *p++ = state;
+            }
+            runGap = gap;
+            gap = 0;
+            length = 1;
+            state = row[j];
+        }
+    }
+    if ( length > 0 ) {
+        p = putVarint( putVarint( p, runGap ), length );
+        *p++ = state;
+    }
+    r->used = (size_t)( p - r->code );
+    return 0;
+}
+
+/// Appends a cycle as a keyframe or a delta.
+
+int record_cycle( Recorder *r, uint64_t cycle, const Grid *g ) {
+
+    if ( g->width != r->info.width || g->height != r->info.height
+         || ( r->started && cycle != r->next ) ) {
+        errno = EINVAL;
+        return -1;
+    }
+    int key = !r->started || cycle % r->info.keyEvery == 0;
+    FrameHeader f = { .cycle = cycle, .kind = key ? FRAME_KEY : FRAME_DELTA };
+    if ( ( key ? encodeKey( r, g, &f.changes ) : encodeDelta( r, g, &f.changes ) ) != 0 ) {
+        errno = ENOMEM;
+        return -1;
+    }
+    f.changes = r->started ? f.changes : 0;
+    f.bytes = r->used;
+    if ( fwrite( &f, sizeof f, 1, r->file ) != 1
+         || ( r->used > 0 && fwrite( r->code, r->used, 1, r->file ) != 1 ) ) {
+        return -1;
+    }
+    r->started = 1;
+    r->next = cycle + 1;
+    return 0;
+}
+
+/// Writes what is buffered, closes the file and releases the recorder.
+
+int record_close( Recorder *r ) {
+    if ( r == NULL ) {
+        return 0;
+    }
+    int status = 0;
+    if ( r->file != NULL && fclose( r->file ) != 0 ) {
+        status = -1;
+    }
+    free( r->prev );
+    free( r->code );
+    free( r );
+    return status;
+}
+
+/// Opens a trajectory, reading the header of every frame to find the
+/// keyframes and where the last complete frame ends.
+
+Trajectory *trajectory_open( const char *path, RecordInfo *info ) {
+
+    Trajectory *t = calloc( 1, sizeof (Trajectory) );
+    if ( t == NULL ) {
+        return NULL;
+    }
+    t->file = fopen( path, "rb" );
+    if ( t->file == NULL ) {
+        trajectory_close( t );
+        return NULL;
+    }
+
+    Header h;
+    struct stat st;
+    if ( fread( &h, sizeof h, 1, t->file ) != 1 || memcmp( h.magic, RECORD_MAGIC, sizeof h.magic ) != 0
+         || h.version != RECORD_VERSION || h.order != RECORD_ORDER
+         || h.info.width == 0 || h.info.height == 0
+         || h.info.width > SIZE_MAX / h.info.height || fstat( fileno( t->file ), &st ) != 0 ) {
+        trajectory_close( t );
+        return NULL;
+    }
+    t->info = h.info;
+    t->cells = malloc( h.info.width * h.info.height );
+    if ( t->cells == NULL ) {
+        trajectory_close( t );
+        return NULL;
+    }
+
+    size_t room = 0; // of keys and keyCycles
+    off_t at = (off_t) sizeof h;
+    FrameHeader f;
+    while ( fseeko( t->file, at, SEEK_SET ) == 0 && fread( &f, sizeof f, 1, t->file ) == 1 ) {
+        off_t end = at + (off_t) sizeof f + (off_t) f.bytes;
+        if ( end > st.st_size || f.bytes > (uint64_t) st.st_size
+             || ( f.kind != FRAME_KEY && f.kind != FRAME_DELTA )
+             || ( t->cycles == 0 && f.kind != FRAME_KEY )
+             || ( t->cycles > 0 && f.cycle != t->first + t->cycles ) ) {
+            break; // cut short, or not a frame
+        }
+        if ( f.kind == FRAME_KEY ) {
+            if ( t->keyCount == room ) {
+                room = room ? 2 * room : 64;
+                off_t *keys = realloc( t->keys, room * sizeof (off_t) );
+                if ( keys == NULL ) {
+                    trajectory_close( t );
+                    return NULL;
+                }
+                t->keys = keys;
+                uint64_t *cycles = realloc( t->keyCycles, room * sizeof (uint64_t) );
+                if ( cycles == NULL ) {
+                    trajectory_close( t );
+                    return NULL;
+                }
+                t->keyCycles = cycles;
+            }
+            t->keys[t->keyCount] = at;
+            t->keyCycles[t->keyCount++] = f.cycle;
+        }
+        if ( t->cycles == 0 ) {
+            t->first = f.cycle;
+        }
+        t->cycles++;
+        at = end;
+    }
+    *info = t->info;
+    return t;
+}
+
+/// Returns the first cycle of a trajectory.
+
+uint64_t trajectory_first( const Trajectory *t ) {
+    return t->first;
+}
+
+/// Returns the number of cycles in a trajectory.
+
+uint64_t trajectory_cycles( const Trajectory *t ) {
+    return t->cycles;
+}
+
+/// Reads the frame at an offset and applies it to t->cells.
+/// @return 0 on success, -1 if the frame could not be read or is corrupt
+
+static int applyFrame( Trajectory *t, off_t at, FrameHeader *f ) {
+
+    if ( fseeko( t->file, at, SEEK_SET ) != 0 || fread( f, sizeof *f, 1, t->file ) != 1
+         || reserve( &t->code, &t->capacity, f->bytes ) != 0
+         || ( f->bytes > 0 && fread( t->code, f->bytes, 1, t->file ) != 1 ) ) {
+        return -1;
+    }
+
+    const unsigned char *p = t->code;
+    const unsigned char *end = t->code + f->bytes;
+    uint64_t area = t->info.width * t->info.height;
+    uint64_t i = 0;
+    while ( p < end ) {
+        uint64_t gap = 0;
+        uint64_t length;
+        if ( ( f->kind == FRAME_DELTA && ( p = getVarint( p, end, &gap ) ) == NULL )
+             || ( p = getVarint( p, end, &length ) ) == NULL || p == end
+             || gap > area - i || length > area - i - gap ) {
+            return -1;
+        }
+        i += gap;
+        memset( t->cells + i, *p++, length );
+        i += length;
+    }
+    return f->kind == FRAME_KEY && i != area ? -1 : 0;
+}
+
+/// Decodes one cycle into a grid.
+
+int trajectory_seek( Trajectory *t, uint64_t cycle, Grid *g, uint64_t *changes ) {
+
+    if ( cycle < t->first || cycle - t->first >= t->cycles
+         || g->width != t->info.width || g->height != t->info.height ) {
+        return -1;
+    }
+
+    // the last keyframe at or before the cycle
+    size_t lo = 0;
+    size_t hi = t->keyCount;
+    while ( hi - lo > 1 ) {
+        size_t mid = ( lo + hi ) / 2;
+        if ( t->keyCycles[mid] <= cycle ) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    FrameHeader f;
+    if ( !t->decoded || t->at > cycle || t->at < t->keyCycles[lo] ) {
+        t->decoded = 0;
+        if ( applyFrame( t, t->keys[lo], &f ) != 0 ) {
+            return -1;
+        }
+        t->at = f.cycle;
+        t->changes = f.changes;
+        t->after = ftello( t->file );
+        t->decoded = 1;
+    }
+    while ( t->at < cycle ) {
+        if ( applyFrame( t, t->after, &f ) != 0 ) {
+            t->decoded = 0;
+            return -1;
+        }
+        t->at = f.cycle;
+        t->changes = f.changes;
+        t->after = ftello( t->file );
+    }
+
+    for ( size_t r = 0; r < g->height; r++ ) {
+        memcpy( grid_row( g, r ), t->cells + r * g->width, g->width );
+    }
+    if ( changes != NULL ) {
+        *changes = t->changes;
+    }
+    return 0;
+}
+
+/// Closes a trajectory. NULL is ignored.
+
+void trajectory_close( Trajectory *t ) {
+    if ( t == NULL ) {
+        return;
+    }
+    if ( t->file != NULL ) {
+        fclose( t->file );
+    }
+    free( t->keys );
+    free( t->keyCycles );
+    free( t->cells );
+    free( t->code );
+    free( t );
+}
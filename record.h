@@ -0,0 +1,130 @@
+/*
+ * File:    record.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Binary trajectories of a run: every cycle of the grid, small
+ * enough to keep for every run. A trajectory file is a header holding
+ * the size and parameters of the run, followed by one frame per cycle.
+ * A frame is either a keyframe, the whole grid, or a delta, the cells
+ * that changed since the cycle before. Cells are numbered row by row
+ * without the halo (index = row * width + column).
+ *      Keyframes are run-length encoded as pairs (length, state). Deltas
+ * are triples (unchanged cells skipped, length, state): a run of cells
+ * that all changed to the same state, after a gap of cells that did not
+ * change. Lengths and gaps are unsigned LEB128 varints, so the fire
+ * front of a large grid costs a few bytes per run instead of a byte per
+ * cell. Frames are collected in a large buffer and written in big
+ * blocks, never per cell.
+ *      A keyframe is written every keyEvery cycles, so any cycle is
+ * reached by decoding the keyframe before it and at most keyEvery - 1
+ * deltas. Every frame starts with its cycle, kind and length, so a
+ * reader finds the keyframes without decoding anything, and a
+ * trajectory cut short by a killed run is still read up to its last
+ * complete frame.
+ *
+ */
+
+#ifndef WILDFIRE_RECORD_H
+#define WILDFIRE_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+
+/// What a trajectory records, besides the cells.
+///
+typedef struct {
+    uint64_t width;    ///< number of columns in the grid
+    uint64_t height;   ///< number of rows in the grid
+    uint64_t seed;     ///< seed of the random number streams
+    uint64_t keyEvery; ///< cycles between keyframes
+    float pCatch;      ///< probability of a tree catching fire
+    float density;     ///< proportion of cells holding a tree at cycle 0
+    float pBurning;    ///< proportion of trees burning at cycle 0
+    float pNeighbor;   ///< proportion of burning neighbors needed to spread
+} RecordInfo;
+
+/// Opaque trajectory being written.
+///
+typedef struct Recorder Recorder;
+
+/// Opaque trajectory being read.
+///
+typedef struct Trajectory Trajectory;
+
+/// Creates a trajectory file, replacing any file at path.
+///
+/// @param path: name of the file
+/// @param info: size and parameters of the run; keyEvery at least 1
+/// @return the recorder, or NULL with errno set if the file could not be
+///         created or memory could not be obtained
+///
+Recorder *record_open( const char *path, const RecordInfo *info );
+
+/// Appends a cycle: a keyframe for the first cycle recorded and every
+/// keyEvery cycles after, a delta from the cycle recorded before
+/// otherwise. Cycles must be recorded in order, one after the other.
+///
+/// @param r: the recorder
+/// @param cycle: the cycle
+/// @param g: grid of the cycle, of the size of the trajectory
+/// @return 0 on success, -1 with errno set if the file could not be written
+///
+int record_cycle( Recorder *r, uint64_t cycle, const Grid *g );
+
+/// Writes what is buffered, closes the file and releases the recorder.
+/// NULL is ignored.
+///
+/// @param r: the recorder
+/// @return 0 on success, -1 with errno set if anything could not be written
+///
+int record_close( Recorder *r );
+
+/// Opens a trajectory and finds its keyframes.
+///
+/// @param path: name of the file
+/// @param info: receives the size and parameters of the run
+/// @return the trajectory, or NULL if the file could not be opened or is
+///         not a trajectory
+///
+Trajectory *trajectory_open( const char *path, RecordInfo *info );
+
+/// Returns the first cycle of a trajectory.
+///
+/// @param t: the trajectory
+///
+uint64_t trajectory_first( const Trajectory *t );
+
+/// Returns the number of cycles in a trajectory, up to its last complete
+/// frame.
+///
+/// @param t: the trajectory
+///
+uint64_t trajectory_cycles( const Trajectory *t );
+
+/// Decodes one cycle into a grid, starting from the nearest keyframe
+/// before it, or from the cycle decoded by the previous call if that is
+/// nearer. Reading the cycles in order decodes each frame once.
+///
+/// @param t: the trajectory
+/// @param cycle: the cycle, from trajectory_first up to but not including
+///               trajectory_first + trajectory_cycles
+/// @param g: receives the cycle; of the size of the trajectory
+/// @param changes: receives the number of cells changed since the cycle
+///                 before, burn stages included, or 0 for the first
+///                 cycle; may be NULL
+/// @return 0 on success, -1 if the cycle is not in the trajectory or the
+///         file could not be read
+///
+int trajectory_seek( Trajectory *t, uint64_t cycle, Grid *g, uint64_t *changes );
+
+/// Closes a trajectory. NULL is ignored.
+///
+/// @param t: the trajectory
+///
+void trajectory_close( Trajectory *t );
+
+#endif
@@ -0,0 +1,165 @@
+// file: render.c
+// The overlay display on a thread of its own, fed by a lock-free ring of
+// frames that the simulation never waits on.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers; clock_nanosleep
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "display.h"
+#include "prof.h"
+#include "render.h"
+
+#define SLOTS 4 ///< frames in the ring
+#define LINE 64 ///< bytes in a cache line
+#define CLAIM_POLL_NS 1000000 ///< pause of a claim waiting for a slot
+
+struct Renderer {
+    Frame *screen;             // what is on the terminal
+    int rows;                  // rows of characters in a frame
+    int cols;                  // columns of characters in a frame
+    long interval;             // nanoseconds between frames drawn
+    RenderFrame slots[SLOTS];  // frame number n is in slots[n % SLOTS]
+    pthread_t thread;          // the render thread
+    int stopping;              // 1 once render_stop is called
+    char apart[LINE];          // keeps head and tail on cache lines of their own
+    uint64_t head;             // frames published; written by the simulation only
+    char apart2[LINE];
+    uint64_t tail;             // frames drawn or skipped; written by the render thread only
+    char apart3[LINE];
+};
+
+/// Draws one frame, rows and status lines, with one write to the terminal.
+
+static void show( Renderer *r, const RenderFrame *f ) {
+    PROF_NOW(shown);
+    for ( int i = 0; i < r->rows; i++ ) {
+        frame_row( r->screen, i, f->text + (size_t) i * r->cols );
+    }
+    for ( int s = 0; s < RENDER_STATUS_LINES; s++ ) {
+        frame_text( r->screen, r->rows + s, f->status[s] );
+    }
+    PROF_COUNT( PROF_BYTES, frame_flush( r->screen ) );
+    PROF_PHASE( PROF_RENDER, shown );
+}
+
+/// Adds nanoseconds to a time.
+
+static void later( struct timespec *t, long ns ) {
+    t->tv_nsec += ns;
+    while ( t->tv_nsec >= 1000000000L ) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+/// Body of the render thread. Once per interval it draws the newest frame
+/// published, if any, and lets go of it and of every older one, which are
+/// skipped. A frame that takes longer than the interval to draw delays the
+/// next one rather than making the thread draw twice as fast after it.
+
+static void *draw( void *arg ) {
+
+    Renderer *r = arg;
+    struct timespec next;
+    clock_gettime( CLOCK_MONOTONIC, &next );
+
+    for ( ;; ) {
+        // stopping is read first: every frame published before it is set is seen
+        int stopping = __atomic_load_n( &r->stopping, __ATOMIC_ACQUIRE );
+        uint64_t head = __atomic_load_n( &r->head, __ATOMIC_ACQUIRE );
+        if ( head != r->tail ) {
+            PROF_COUNT( PROF_DROPPED, head - r->tail - 1 );
+            show( r, &r->slots[( head - 1 ) % SLOTS] );
+            __atomic_store_n( &r->tail, head, __ATOMIC_RELEASE );
+        } else if ( stopping ) {
+            return NULL;
+        }
+
+        struct timespec now;
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        later( &next, r->interval );
+        if ( now.tv_sec > next.tv_sec || ( now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec ) ) {
+            next = now; // behind; the next frame is drawn at once
+        }
+        clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL );
+    }
+}
+
+/// Releases a renderer whose thread is not running.
+
+static void release( Renderer *r ) {
+    for ( int s = 0; s < SLOTS; s++ ) {
+        free( r->slots[s].text );
+    }
+    frame_destroy( r->screen );
+    free( r );
+}
+
+/// Clears the terminal and starts a render thread.
+
+Renderer *render_start( int rows, int cols, int fps ) {
+
+    Renderer *r = calloc( 1, sizeof (Renderer) );
+    if ( r == NULL ) {
+        return NULL;
+    }
+    r->rows = rows;
+    r->cols = cols;
+    r->interval = 1000000000L / ( fps > 0 ? fps : 1 );
+    r->screen = frame_create( rows, cols );
+    int failed = r->screen == NULL;
+    for ( int s = 0; s < SLOTS; s++ ) {
+        r->slots[s].text = malloc( (size_t) rows * cols );
+        failed |= r->slots[s].text == NULL;
+    }
+    if ( failed ) {
+        release( r );
+        return NULL;
+    }
+
+    frame_clear( r->screen );
+    if ( pthread_create( &r->thread, NULL, draw, r ) != 0 ) {
+        release( r );
+        return NULL;
+    }
+    return r;
+}
+
+/// Claims the slot of the next frame.
+
+RenderFrame *render_claim( Renderer *r, int wait ) {
+    uint64_t head = __atomic_load_n( &r->head, __ATOMIC_RELAXED );
+    while ( head - __atomic_load_n( &r->tail, __ATOMIC_ACQUIRE ) == SLOTS ) {
+        if ( !wait ) {
+            PROF_COUNT( PROF_DROPPED, 1 );
+            return NULL;
+        }
+        struct timespec pause = { 0, CLAIM_POLL_NS };
+        nanosleep( &pause, NULL );
+    }
+    return &r->slots[head % SLOTS];
+}
+
+/// Publishes the frame filled since render_claim.
+
+void render_publish( Renderer *r ) {
+    uint64_t head = __atomic_load_n( &r->head, __ATOMIC_RELAXED );
+    __atomic_store_n( &r->head, head + 1, __ATOMIC_RELEASE );
+}
+
+/// Stops the render thread once the newest frame is drawn.
+
+void render_stop( Renderer *r ) {
+    if ( r == NULL ) {
+        return;
+    }
+    __atomic_store_n( &r->stopping, 1, __ATOMIC_RELEASE );
+    pthread_join( r->thread, NULL );
+    release( r );
+}
@@ -0,0 +1,74 @@
+/*
+ * File:    render.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      The overlay display on a thread of its own. The simulation fills
+ * frames, the characters of the grid and the status lines below it, and
+ * publishes them into a ring of a few slots; the render thread draws the
+ * newest frame published through a Frame renderer (see display.h) at
+ * most a set number of times a second. Neither side ever waits for the
+ * other: the render thread skips the frames published while it was
+ * drawing, and a simulation that finds every slot in use skips its
+ * frame, so a slow terminal never holds up the stepping, nor stepping
+ * the terminal.
+ *      The ring has one producer and one consumer and no lock. Each side
+ * writes one counter, the frames it published or is done with, and
+ * reads the other's with acquire ordering, so a slot is never filled
+ * while it is drawn.
+ *
+ */
+
+#ifndef WILDFIRE_RENDER_H
+#define WILDFIRE_RENDER_H
+
+#define RENDER_STATUS_LINES 2 ///< status lines below the grid
+#define RENDER_STATUS_MAX 160 ///< room in a status line, terminator included
+
+/// One frame to be drawn.
+///
+typedef struct {
+    char *text;                                         ///< rows by cols characters,
+                                                        ///< row by row, unterminated
+    char status[RENDER_STATUS_LINES][RENDER_STATUS_MAX]; ///< lines below the grid
+} RenderFrame;
+
+/// Opaque render thread and its ring of frames.
+///
+typedef struct Renderer Renderer;
+
+/// Clears the terminal and starts a render thread.
+///
+/// @param rows: rows of characters in a frame
+/// @param cols: columns of characters in a frame
+/// @param fps: most frames drawn a second, at least 1
+/// @return the renderer, or NULL if memory or the thread could not be
+///         obtained
+///
+Renderer *render_start( int rows, int cols, int fps );
+
+/// Claims the slot of the next frame, to be filled and published.
+///
+/// @param r: the renderer
+/// @param wait: 1 to wait for a slot while the render thread is drawing,
+///              0 to give up at once
+/// @return the frame to fill, or NULL if every slot is in use and wait is 0
+///
+RenderFrame *render_claim( Renderer *r, int wait );
+
+/// Publishes the frame filled since render_claim. The render thread
+/// draws it unless a newer one is published before it gets to it.
+///
+/// @param r: the renderer
+///
+void render_publish( Renderer *r );
+
+/// Draws the newest frame published if it is not yet on the terminal,
+/// stops the render thread and releases the renderer. NULL is ignored.
+///
+/// @param r: the renderer
+///
+void render_stop( Renderer *r );
+
+#endif
@@ -0,0 +1,157 @@
+// file: replay.c
+// Prints cycles of a trajectory written by wildfire --record, seeking to
+// any cycle through the keyframe before it.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers
+
+#include <getopt.h>
+#include <inttypes.h> // PRIu64
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h> // stat
+
+#include "grid.h"
+#include "record.h"
+
+/// Prints usage information to stderr and quits.
+
+static void help() {
+    fprintf( stderr, "usage: replay [options] FILE\n" );
+    fprintf( stderr, "Prints cycles of a trajectory written by wildfire --record FILE.\n" );
+    fprintf( stderr, " -H # View replay options and quit.\n" );
+    fprintf( stderr, " -cN # first cycle printed. default: the last cycle recorded.\n" );
+    fprintf( stderr, " -nN # number of cycles printed. 0 < N. default: 1.\n" );
+    fprintf( stderr, " -i # print the size, parameters and length of the trajectory only.\n" );
+    exit( EXIT_SUCCESS );
+}
+
+/// Prints the size, parameters and length of a trajectory.
+/// @param path name of the trajectory
+/// @param info size and parameters of the run
+/// @param t the trajectory
+
+static void summary( const char *path, const RecordInfo *info, const Trajectory *t ) {
+
+    struct stat st;
+    uint64_t cycles = trajectory_cycles( t );
+    long long bytes = stat( path, &st ) == 0 ? (long long) st.st_size : -1;
+
+    printf( "size %" PRIu64 "x%" PRIu64 ", pCatch %.2f, density %.2f, pBurning %.2f, pNeighbor %.2f\n",
+            info->width, info->height, info->pCatch, info->density, info->pBurning, info->pNeighbor );
+    printf( "seed %" PRIu64 ", %" PRIu64 " cycles from %" PRIu64 ", keyframe every %" PRIu64 " cycles\n",
+            info->seed, cycles, trajectory_first( t ), info->keyEvery );
+    printf( "file %lld bytes, %.1f bytes per cycle, %.4f bytes per cell and cycle\n", bytes,
+            cycles > 0 ? (double) bytes / cycles : 0.0,
+            cycles > 0 ? (double) bytes / cycles / ( info->width * info->height ) : 0.0 );
+}
+
+/// Prints one cycle as the print mode of wildfire shows it.
+/// @param g grid of the cycle
+/// @param cycle the cycle
+/// @param changes cells changed since the cycle before, burn stages included
+/// @param line room for the characters of one row, and a newline
+
+static void printCycle( const Grid *g, uint64_t cycle, uint64_t changes, char *line ) {
+    for ( size_t i = 0; i < g->height; i++ ) {
+        const cell_t *row = grid_row( g, i );
+        for ( size_t j = 0; j < g->width; j++ ) {
+            line[j] = cell_char[row[j]];
+        }
+        line[g->width] = '\n';
+        fwrite( line, 1, g->width + 1, stdout );
+    }
+    printf( "cycle %" PRIu64 ", cells changed %" PRIu64 "\n", cycle, changes );
+}
+
+int main( int argc, char *argv[] ) {
+
+    int c;
+    int info = 0; // 1 to print the summary only
+    long first = -1; // first cycle printed; -1 for the last
+    long count = 1; // cycles printed
+
+    while ( ( c = getopt( argc, argv, "Hc:n:i" ) ) != -1 ) {
+        switch ( c ) {
+        case 'H':
+            help();
+            break;
+        case 'c':
+            first = strtol( optarg, NULL, 10 );
+            if ( first < 0 ) {
+                fprintf( stderr, "(-cN) cycle must be a non-negative integer.\n" );
+                help();
+            }
+            break;
+        case 'n':
+            count = strtol( optarg, NULL, 10 );
+            if ( count < 1 ) {
+                fprintf( stderr, "(-nN) number of cycles must be a positive integer.\n" );
+                help();
+            }
+            break;
+        case 'i':
+            info = 1;
+            break;
+        default:
+            help();
+        }
+    }
+    if ( optind != argc - 1 ) {
+        fprintf( stderr, "one trajectory file is needed.\n" );
+        help();
+    }
+    const char *path = argv[optind];
+
+    RecordInfo ri;
+    Trajectory *t = trajectory_open( path, &ri );
+    if ( t == NULL ) {
+        fprintf( stderr, "cannot read %s: not a trajectory of this program.\n", path );
+        return EXIT_FAILURE;
+    }
+    if ( info ) {
+        summary( path, &ri, t );
+        trajectory_close( t );
+        return EXIT_SUCCESS;
+    }
+
+    if ( trajectory_cycles( t ) == 0 ) {
+        fprintf( stderr, "%s holds no complete cycle.\n", path );
+        trajectory_close( t );
+        return EXIT_FAILURE;
+    }
+    uint64_t lo = trajectory_first( t );
+    uint64_t end = lo + trajectory_cycles( t ); // after the last cycle recorded
+    uint64_t from = first < 0 ? end - 1 : (uint64_t) first;
+    if ( from < lo || from >= end ) {
+        fprintf( stderr, "cycle %ld is not in %s, which holds cycles %" PRIu64 " to %" PRIu64 ".\n",
+                 first, path, lo, end - 1 );
+        trajectory_close( t );
+        return EXIT_FAILURE;
+    }
+
+    Grid *g = grid_create( (size_t) ri.width, (size_t) ri.height );
+    char *line = malloc( (size_t) ri.width + 1 );
+    if ( g == NULL || line == NULL ) {
+        fprintf( stderr, "not enough memory for a %" PRIu64 " by %" PRIu64 " grid.\n", ri.width, ri.height );
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    for ( uint64_t cyc = from; cyc < end && cyc < from + (uint64_t) count; cyc++ ) {
+        uint64_t changes;
+        if ( trajectory_seek( t, cyc, g, &changes ) != 0 ) {
+            fprintf( stderr, "cannot read cycle %" PRIu64 " of %s: damaged trajectory.\n", cyc, path );
+            status = EXIT_FAILURE;
+            break;
+        }
+        printCycle( g, cyc, changes, line );
+    }
+
+    free( line );
+    grid_destroy( g );
+    trajectory_close( t );
+    return status;
+}
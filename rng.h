@@ -0,0 +1,100 @@
+/*
+ * File:    rng.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Counter-based random numbers. A draw is a pure function of a key
+ * and a counter, so any cell's draw can be computed on its own, by any
+ * thread, in any order, and a run is reproduced exactly from its seed.
+ * Keys are derived from the seed and a stream number (the cycle of the
+ * simulation, or RNG_INIT_STREAM for the initial grid); counters are
+ * cell indexes. The generator is Widynski's "Squares" with the key
+ * scrambled by the splitmix64 finalizer.
+ *
+ */
+
+#ifndef WILDFIRE_RNG_H
+#define WILDFIRE_RNG_H
+
+#include <stdint.h>
+
+#define RNG_INIT_STREAM UINT64_MAX ///< stream used to build the initial grid
+
+/// Mixes the bits of a 64 bit value (the splitmix64 finalizer).
+///
+/// @param z: value to be mixed
+///
+static inline uint64_t rng_mix( uint64_t z ) {
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    return z ^ ( z >> 31 );
+}
+
+/// Derives the key of one stream of draws.
+///
+/// @param seed: seed of the run
+/// @param stream: stream number, usually the cycle
+///
+static inline uint64_t rng_key( uint64_t seed, uint64_t stream ) {
+    return rng_mix( seed ^ rng_mix( stream + 0x9e3779b97f4a7c15ULL ) ) | 1;
+}
+
+/// Returns 32 random bits for one counter of a stream.
+///
+/// @param key: key of the stream
+/// @param ctr: the counter, usually a cell index
+///
+static inline uint32_t rng_draw( uint64_t key, uint64_t ctr ) {
+    uint64_t x = ctr * key;
+    uint64_t y = x;
+    uint64_t z = y + key;
+    x = x * x + y; x = ( x >> 32 ) | ( x << 32 );
+    x = x * x + z; x = ( x >> 32 ) | ( x << 32 );
+    x = x * x + y; x = ( x >> 32 ) | ( x << 32 );
+    return (uint32_t)( ( x * x + z ) >> 32 );
+}
+
+/// Returns 64 random bits for one counter of a stream.
+///
+/// @param key: key of the stream
+/// @param ctr: the counter
+///
+static inline uint64_t rng_draw64( uint64_t key, uint64_t ctr ) {
+    return ( (uint64_t) rng_draw( key, 2 * ctr ) << 32 ) | rng_draw( key, 2 * ctr + 1 );
+}
+
+/// Returns a uniformly distributed integer in [0, n) for one counter of
+/// a stream, without bias. The 64 bit draw is scaled by multiplication
+/// (Lemire's method); the rare draws that would favor some values are
+/// rejected and redrawn from a neighboring key.
+///
+/// @param key: key of the stream
+/// @param ctr: the counter
+/// @param n: number of possible values; greater than 0
+///
+static inline uint64_t rng_below( uint64_t key, uint64_t ctr, uint64_t n ) {
+    __extension__ typedef unsigned __int128 wide;
+    wide m = (wide) rng_draw64( key, ctr ) * n;
+    uint64_t low = (uint64_t) m;
+    if ( low < n ) {
+        uint64_t threshold = -n % n; // 2^64 mod n
+        while ( low < threshold ) {
+            key += 2;
+            m = (wide) rng_draw64( key, ctr ) * n;
+            low = (uint64_t) m;
+        }
+    }
+    return (uint64_t)( m >> 64 );
+}
+
+/// Converts a probability to the limit a 32 bit draw must be under for
+/// the event to happen, so draws are compared without floating point.
+///
+/// @param p: probability in [0, 1]
+///
+static inline uint64_t rng_limit( double p ) {
+    return (uint64_t)( p * 4294967296.0 );
+}
+
+#endif
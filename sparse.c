@@ -0,0 +1,170 @@
+// file: sparse.c
+// Active-front stepping that visits only the burning trees and their
+// neighbors.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#include <stdlib.h>
+
+#include "prof.h"
+#include "rng.h"
+#include "sparse.h"
+
+/// The burning trees of a grid, and scratch lists for one step.
+/// Cells are stored as offsets from the first cell of the grid.
+
+struct Front {
+    size_t *burning;       // burning trees
+    size_t count;          // number of burning trees
+    size_t capacity;       // room in burning
+    size_t *seen;          // living trees examined this step
+    size_t seenCapacity;   // room in seen
+    size_t *caught;        // living trees that catch fire this step
+    size_t caughtCapacity; // room in caught
+};
+
+/// Makes room for at least need offsets in a list.
+/// @return 0 on success, -1 if memory could not be obtained
+
+static int reserve( size_t **list, size_t *capacity, size_t need ) {
+    if ( need <= *capacity ) {
+        return 0;
+    }
+    size_t room = *capacity ? *capacity : 256;
+    while ( room < need ) {
+        room *= 2;
+    }
+    size_t *p = realloc( *list, room * sizeof (size_t) );
+    if ( p == NULL ) {
+        return -1;
+    }
+    *list = p;
+    *capacity = room;
+    return 0;
+}
+
+/// Creates an empty front.
+
+Front *front_create() {
+    return calloc( 1, sizeof (Front) );
+}
+
+/// Releases a front. NULL is ignored.
+
+void front_destroy( Front *f ) {
+    if ( f == NULL ) {
+        return;
+    }
+    free( f->burning );
+    free( f->seen );
+    free( f->caught );
+    free( f );
+}
+
+/// Rebuilds the front by scanning every cell of a grid for burning trees.
+
+int front_scan( Front *f, const Grid *g ) {
+    f->count = 0;
+    for ( size_t r = 0; r < g->height; r++ ) {
+        const cell_t *row = grid_row( g, r );
+        for ( size_t c = 0; c < g->width; c++ ) {
+            if ( row[c] & CELL_FIRE ) {
+                if ( reserve( &f->burning, &f->capacity, f->count + 1 ) != 0 ) {
+                    return -1;
+                }
+                f->burning[f->count++] = r * g->stride + c;
+            }
+        }
+    }
+    return 0;
+}
+
+/// Returns the number of burning trees in the front.
+
+size_t front_size( const Front *f ) {
+    return f->count;
+}
+
+/// Computes the next cycle of a grid in place. Living neighbors of burning
+/// trees are marked as they are examined so each is drawn for only once;
+/// all decisions are made before any cell changes state.
+
+int front_step( Front *f, Grid *g, const SpreadRule *rule, uint64_t key,
+                uint64_t limit, Summary *summary, long *ignited, long *burnedOut ) {
+
+    const ptrdiff_t s = (ptrdiff_t) g->stride;
+    const ptrdiff_t around[8] = { -s - 1, -s, -s + 1, -1, 1, s - 1, s, s + 1 };
+
+    cell_t *cells = g->cells;
+    size_t seen = 0;
+    size_t caught = 0;
+    size_t draws = 0; // counted for the profile only
+    long out = 0;
+
+    for ( size_t i = 0; i < f->count; i++ ) {
+        if ( reserve( &f->seen, &f->seenCapacity, seen + 8 ) != 0
+             || reserve( &f->caught, &f->caughtCapacity, caught + 8 ) != 0 ) {
+            return -1;
+        }
+        cell_t *b = cells + f->burning[i];
+        for ( int k = 0; k < 8; k++ ) {
+            cell_t *n = b + around[k];
+            if ( *n != CELL_LIVING ) {
+                continue; // not a tree, burning, or already examined
+            }
+            *n |= CELL_MARK;
+            size_t off = (size_t)( n - cells );
+            f->seen[seen++] = off;
+
+            unsigned sum = 0;
+            for ( int j = 0; j < 8; j++ ) {
+                sum += n[around[j]] & CELL_COUNT_MASK;
+            }
+            if ( rule->spreads[sum] ) {
+                size_t r = off / g->stride;
+                uint64_t index = (uint64_t) r * g->width + ( off - r * g->stride );
+                draws++;
+                if ( rng_draw( key, index ) < limit ) {
+                    f->caught[caught++] = off;
+                }
+            }
+        }
+    }
+
+    // advance the burning trees, dropping the ones that burn out
+    size_t kept = 0;
+    for ( size_t i = 0; i < f->count; i++ ) {
+        cell_t *b = cells + f->burning[i];
+        if ( *b == CELL_BURN2 ) {
+            *b = CELL_BURNT;
+            out++;
+        } else {
+            *b = (cell_t)( *b + ( CELL_BURN0 - CELL_KINDLED ) );
+            f->burning[kept++] = f->burning[i];
+        }
+    }
+
+    for ( size_t i = 0; i < seen; i++ ) {
+        cells[f->seen[i]] = CELL_LIVING;
+    }
+
+    if ( reserve( &f->burning, &f->capacity, kept + caught ) != 0 ) {
+        return -1;
+    }
+    for ( size_t i = 0; i < caught; i++ ) {
+        cells[f->caught[i]] = CELL_BURN0;
+        f->burning[kept++] = f->caught[i];
+        if ( summary != NULL ) {
+            size_t r = f->caught[i] / g->stride;
+            summary_ignite( summary, r, f->caught[i] - r * g->stride );
+        }
+    }
+    PROF_COUNT( PROF_RNG_DRAWS, draws );
+    PROF_COUNT( PROF_EVALUATED, f->count + seen );
+    PROF_COUNT( PROF_SKIPPED, g->width * g->height - f->count - seen );
+    f->count = kept;
+
+    *ignited = (long) caught;
+    *burnedOut = out;
+    return 0;
+}
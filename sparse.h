@@ -0,0 +1,75 @@
+/*
+ * File:    sparse.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Active-front stepping. Only a burning tree can change state on
+ * its own, and only a living tree next to a burning tree can catch
+ * fire, so a cycle is fully determined by the burning trees and their
+ * 8 neighbors. A front keeps the list of burning trees and steps the
+ * grid in place by visiting just those cells, which makes a cycle
+ * O(perimeter of the fire) instead of O(area of the grid).
+ *      The result of a step is identical to a dense update: every
+ * decision reads the grid as it was at the start of the cycle and every
+ * draw is keyed by cell index.
+ *
+ */
+
+#ifndef WILDFIRE_SPARSE_H
+#define WILDFIRE_SPARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "kernel.h"
+#include "summary.h"
+
+/// Opaque list of the burning trees of a grid.
+///
+typedef struct Front Front;
+
+/// Creates an empty front.
+///
+/// @return the front, or NULL if memory could not be obtained
+///
+Front *front_create();
+
+/// Releases a front. NULL is ignored.
+///
+/// @param f: the front
+///
+void front_destroy( Front *f );
+
+/// Rebuilds the front by scanning every cell of a grid for burning trees.
+///
+/// @param f: the front
+/// @param g: the grid
+/// @return 0 on success, -1 if memory could not be obtained
+///
+int front_scan( Front *f, const Grid *g );
+
+/// Returns the number of burning trees in the front.
+///
+/// @param f: the front
+///
+size_t front_size( const Front *f );
+
+/// Computes the next cycle of a grid in place, visiting only the burning
+/// trees and their neighbors. The front must describe the grid.
+///
+/// @param f: front of the grid; updated to the next cycle
+/// @param g: grid to be stepped
+/// @param rule: neighbor sums that spread fire
+/// @param key: key of the random stream of this cycle
+/// @param limit: a draw under this limit catches fire
+/// @param summary: told of every tree that catches fire; NULL for none
+/// @param ignited: receives the number of trees that caught fire
+/// @param burnedOut: receives the number of trees that burned out
+/// @return 0 on success, -1 if memory could not be obtained
+///
+int front_step( Front *f, Grid *g, const SpreadRule *rule, uint64_t key,
+                uint64_t limit, Summary *summary, long *ignited, long *burnedOut );
+
+#endif
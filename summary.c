@@ -0,0 +1,319 @@
+// file: summary.c
+// Tree counts per tile and per level of larger tiles, moved along from the
+// trees that catch fire in each step.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#include <stdlib.h>
+
+#include "summary.h"
+
+#define STAGES 4 ///< cycles a tree burns: KINDLED or BURN0 to BURN2
+#define MAX_LEVELS 48 ///< more than enough levels for any grid in memory
+#define LISTS ( STAGES + 2 ) ///< lists of tiles: burning out in each step mod STAGES, ignited, changed
+
+#define IGNITED STAGES       ///< list of the tiles with trees reported catching fire
+#define CHANGED ( STAGES + 1 ) ///< list of the tiles changed since the levels above were summed
+
+/// Counts of a tile of the lowest level.
+
+typedef struct {
+    uint32_t living;         // living trees
+    uint32_t burnt;          // burned out trees
+    uint32_t ignited;        // trees reported catching fire in this step
+    uint32_t fire[STAGES];   // burning trees, by step of burning out mod STAGES
+    uint32_t listed;         // bit k set while the tile is in list k
+} Tile;
+
+/// Indexes of tiles of the lowest level, each listed once.
+
+typedef struct {
+    size_t *tiles;
+    size_t count;
+} List;
+
+struct Summary {
+    size_t width;            // number of columns in the grid
+    size_t height;           // number of rows in the grid
+    Tile *tiles;             // tiles of the lowest level, row by row
+    List lists[LISTS];       // tiles to visit, so a step costs the tiles on fire
+    int levels;              // levels, the lowest included
+    size_t across[MAX_LEVELS]; // tiles in a row of each level
+    size_t down[MAX_LEVELS];   // rows of tiles of each level
+    SummaryCounts *upper[MAX_LEVELS]; // counts of the tiles of levels 1 and up
+};
+
+/// Returns the number of tiles of a side needed to cover a length.
+
+static size_t cover( size_t length, size_t side ) {
+    return ( length + side - 1 ) / side;
+}
+
+/// Returns the number of cells of a tile of a level.
+
+static uint64_t area( const Summary *s, int level, size_t tr, size_t tc ) {
+    size_t side = (size_t) SUMMARY_TILE << level;
+    size_t rows = s->height - tr * side < side ? s->height - tr * side : side;
+    size_t cols = s->width - tc * side < side ? s->width - tc * side : side;
+    return (uint64_t) rows * cols;
+}
+
+/// Adds the counts of one tile of a level to out.
+
+static void add( const Summary *s, int level, size_t tr, size_t tc, SummaryCounts *out ) {
+    if ( level > 0 ) {
+        const SummaryCounts *u = &s->upper[level][tr * s->across[level] + tc];
+        out->cells += u->cells;
+        out->living += u->living;
+        out->burning += u->burning;
+        out->burnt += u->burnt;
+        return;
+    }
+    const Tile *t = &s->tiles[tr * s->across[0] + tc];
+    out->cells += area( s, 0, tr, tc );
+    out->living += t->living;
+    out->burning += (uint64_t) t->fire[0] + t->fire[1] + t->fire[2] + t->fire[3];
+    out->burnt += t->burnt;
+}
+
+/// Adds the tiles under a tile of a level that have their first cell in
+/// the rectangle of rows r0 to r1 and columns c0 to c1, ends excluded: the
+/// whole tile if the rectangle holds it, or else the tiles below it.
+
+static void gather( const Summary *s, int level, size_t tr, size_t tc,
+                    size_t r0, size_t c0, size_t r1, size_t c1, SummaryCounts *out ) {
+    size_t side = (size_t) SUMMARY_TILE << level;
+    size_t top = tr * side;
+    size_t left = tc * side;
+    size_t bottom = top + side < s->height ? top + side : s->height;
+    size_t right = left + side < s->width ? left + side : s->width;
+    if ( bottom <= r0 || top >= r1 || right <= c0 || left >= c1 ) {
+        return;
+    }
+    if ( ( top >= r0 && bottom <= r1 && left >= c0 && right <= c1 ) || level == 0 ) {
+        // a tile of the lowest level that the rectangle cuts goes with its first cell
+        if ( top >= r0 && left >= c0 ) {
+            add( s, level, tr, tc, out );
+        }
+        return;
+    }
+    for ( size_t r = 2 * tr; r < 2 * tr + 2 && r < s->down[level - 1]; r++ ) {
+        for ( size_t c = 2 * tc; c < 2 * tc + 2 && c < s->across[level - 1]; c++ ) {
+            gather( s, level - 1, r, c, r0, c0, r1, c1, out );
+        }
+    }
+}
+
+/// Sums one tile of a level above the lowest from the four below it.
+
+static void sum( Summary *s, int level, size_t tr, size_t tc ) {
+    SummaryCounts total = { 0, 0, 0, 0 };
+    for ( size_t r = 2 * tr; r < 2 * tr + 2 && r < s->down[level - 1]; r++ ) {
+        for ( size_t c = 2 * tc; c < 2 * tc + 2 && c < s->across[level - 1]; c++ ) {
+            add( s, level - 1, r, c, &total );
+        }
+    }
+    s->upper[level][tr * s->across[level] + tc] = total;
+}
+
+/// Sums every level above the lowest from the level below it.
+
+static void rebuild( Summary *s ) {
+    for ( int level = 1; level < s->levels; level++ ) {
+        for ( size_t tr = 0; tr < s->down[level]; tr++ ) {
+            for ( size_t tc = 0; tc < s->across[level]; tc++ ) {
+                sum( s, level, tr, tc );
+            }
+        }
+    }
+}
+
+/// Sums again the tiles above the ones changed since the last time, and
+/// empties the list of changed tiles.
+
+static void refresh( Summary *s ) {
+    List *l = &s->lists[CHANGED];
+    for ( size_t i = 0; i < l->count; i++ ) {
+        size_t tr = l->tiles[i] / s->across[0];
+        size_t tc = l->tiles[i] % s->across[0];
+        s->tiles[l->tiles[i]].listed &= ~( 1u << CHANGED );
+        for ( int level = 1; level < s->levels; level++ ) {
+            sum( s, level, tr >> level, tc >> level );
+        }
+    }
+    l->count = 0;
+}
+
+/// Adds a tile to a list unless it is in it already. Not for IGNITED,
+/// which is filled from several threads.
+
+static void enlist( Summary *s, size_t i, int list ) {
+    if ( ( s->tiles[i].listed & ( 1u << list ) ) == 0 ) {
+        s->tiles[i].listed |= 1u << list;
+        s->lists[list].tiles[s->lists[list].count++] = i;
+    }
+}
+
+/// Creates the tree counts of a grid.
+
+Summary *summary_create( const Grid *g, long step ) {
+
+    Summary *s = calloc( 1, sizeof (Summary) );
+    if ( s == NULL ) {
+        return NULL;
+    }
+    s->width = g->width;
+    s->height = g->height;
+    int failed = 0;
+    for ( int level = 0; ; level++ ) {
+        size_t side = (size_t) SUMMARY_TILE << level;
+        s->across[level] = cover( g->width, side );
+        s->down[level] = cover( g->height, side );
+        s->levels = level + 1;
+        if ( level == 0 ) {
+            s->tiles = calloc( s->across[0] * s->down[0], sizeof (Tile) );
+            failed |= s->tiles == NULL;
+        } else {
+            s->upper[level] = calloc( s->across[level] * s->down[level], sizeof (SummaryCounts) );
+            failed |= s->upper[level] == NULL;
+        }
+        if ( ( s->across[level] == 1 && s->down[level] == 1 ) || level + 1 == MAX_LEVELS ) {
+            break;
+        }
+    }
+    for ( int k = 0; k < LISTS; k++ ) {
+        s->lists[k].tiles = malloc( s->across[0] * s->down[0] * sizeof (size_t) );
+        failed |= s->lists[k].tiles == NULL;
+    }
+    if ( failed ) {
+        summary_destroy( s );
+        return NULL;
+    }
+
+    for ( size_t r = 0; r < g->height; r++ ) {
+        const cell_t *row = grid_row( g, r );
+        Tile *band = &s->tiles[r / SUMMARY_TILE * s->across[0]];
+        for ( size_t c = 0; c < g->width; c++ ) {
+            Tile *t = &band[c / SUMMARY_TILE];
+            if ( row[c] == CELL_LIVING ) {
+                t->living++;
+            } else if ( row[c] == CELL_BURNT ) {
+                t->burnt++;
+            } else if ( row[c] & CELL_FIRE ) {
+                // KINDLED burns out in the fourth step from now, BURN2 in this one
+                long stage = ( row[c] - CELL_KINDLED ) >> 5;
+                int k = (int)( (size_t)( step + STAGES - 1 - stage ) % STAGES );
+                t->fire[k]++;
+                enlist( s, (size_t)( t - s->tiles ), k );
+            }
+        }
+    }
+    rebuild( s );
+    return s;
+}
+
+/// Releases tree counts. NULL is ignored.
+
+void summary_destroy( Summary *s ) {
+    if ( s == NULL ) {
+        return;
+    }
+    free( s->tiles );
+    for ( int k = 0; k < LISTS; k++ ) {
+        free( s->lists[k].tiles );
+    }
+    for ( int level = 1; level < s->levels; level++ ) {
+        free( s->upper[level] );
+    }
+    free( s );
+}
+
+/// Reports a tree catching fire in the step being computed.
+
+void summary_ignite( Summary *s, size_t r, size_t c ) {
+    size_t i = r / SUMMARY_TILE * s->across[0] + c / SUMMARY_TILE;
+    Tile *t = &s->tiles[i];
+    __atomic_fetch_add( &t->ignited, 1, __ATOMIC_RELAXED );
+    // the first report of the tile in the step lists it
+    if ( ( __atomic_fetch_or( &t->listed, 1u << IGNITED, __ATOMIC_RELAXED ) & ( 1u << IGNITED ) ) == 0 ) {
+        List *l = &s->lists[IGNITED];
+        l->tiles[__atomic_fetch_add( &l->count, 1, __ATOMIC_RELAXED )] = i;
+    }
+}
+
+/// Brings the counts to the next cycle once a step is computed. Only the
+/// tiles listed as burning out in this step or as having trees catch fire
+/// are visited; the levels above are summed again when tallied.
+
+void summary_step( Summary *s, long step ) {
+    int out = (int)( (size_t) step % STAGES );              // burning out in this step
+    int in = (int)( (size_t)( step + STAGES - 1 ) % STAGES ); // burning out three steps on
+
+    List *l = &s->lists[out];
+    for ( size_t k = 0; k < l->count; k++ ) {
+        Tile *t = &s->tiles[l->tiles[k]];
+        t->burnt += t->fire[out];
+        t->fire[out] = 0;
+        t->listed &= ~( 1u << out );
+        enlist( s, l->tiles[k], CHANGED );
+    }
+    l->count = 0;
+
+    l = &s->lists[IGNITED];
+    for ( size_t k = 0; k < l->count; k++ ) {
+        Tile *t = &s->tiles[l->tiles[k]];
+        t->living -= t->ignited;
+        t->fire[in] += t->ignited;
+        t->ignited = 0;
+        t->listed &= ~( 1u << IGNITED );
+        enlist( s, l->tiles[k], in );
+        enlist( s, l->tiles[k], CHANGED );
+    }
+    l->count = 0;
+}
+
+/// Renumbers the steps of the counts by turning the burning trees of every
+/// tile over to the buckets of the new numbers.
+
+void summary_renumber( Summary *s, long from, long to ) {
+    size_t turn = (size_t)( ( to - from ) % STAGES + STAGES ) % STAGES;
+    size_t count = s->across[0] * s->down[0];
+    for ( size_t i = 0; i < count && turn != 0; i++ ) {
+        Tile *t = &s->tiles[i];
+        uint32_t fire[STAGES];
+        uint32_t listed = t->listed & ~( ( 1u << STAGES ) - 1 );
+        for ( size_t k = 0; k < STAGES; k++ ) {
+            fire[( k + turn ) % STAGES] = t->fire[k];
+            listed |= ( ( t->listed >> k ) & 1u ) << ( ( k + turn ) % STAGES );
+        }
+        for ( size_t k = 0; k < STAGES; k++ ) {
+            t->fire[k] = fire[k];
+        }
+        t->listed = listed;
+    }
+    List lists[STAGES];
+    for ( size_t k = 0; k < STAGES; k++ ) {
+        lists[( k + turn ) % STAGES] = s->lists[k];
+    }
+    for ( size_t k = 0; k < STAGES; k++ ) {
+        s->lists[k] = lists[k];
+    }
+}
+
+/// Counts the trees of a rectangle of the grid from the largest tiles that
+/// fit in it, once the levels above the changed tiles are summed again.
+
+void summary_tally( Summary *s, size_t r0, size_t c0, size_t rows, size_t cols,
+                    SummaryCounts *out ) {
+
+    refresh( s );
+    *out = (SummaryCounts) { 0, 0, 0, 0 };
+    size_t r1 = r0 + rows < s->height ? r0 + rows : s->height;
+    size_t c1 = c0 + cols < s->width ? c0 + cols : s->width;
+    int top = s->levels - 1;
+    for ( size_t tr = 0; tr < s->down[top] && r0 < r1 && c0 < c1; tr++ ) {
+        for ( size_t tc = 0; tc < s->across[top]; tc++ ) {
+            gather( s, top, tr, tc, r0, c0, r1, c1, out );
+        }
+    }
+}
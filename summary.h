@@ -0,0 +1,106 @@
+/*
+ * File:    summary.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Tree counts per tile, kept up to date while a grid is stepped, so
+ * that an overview of a huge grid costs the size of the overview and
+ * not of the grid. The grid is cut into tiles of SUMMARY_TILE x
+ * SUMMARY_TILE cells, and each tile counts its living, burning and
+ * burned out trees.
+ *      The engines only report the trees that catch fire (summary_ignite).
+ * A tree burns for exactly four cycles, so the trees of a tile that burn
+ * out in a step are the ones that caught fire three steps before, and
+ * summary_step moves them along without looking at a cell. Only the
+ * tiles with trees catching fire or burning out are visited in a step.
+ * Above the tiles are levels of tiles twice as large, each summing four
+ * of the level below, up to one tile covering the grid; summary_tally
+ * adds up the fewest tiles that cover a rectangle, once it has summed
+ * again the tiles above the ones changed since it was last called, so
+ * the levels cost nothing while no overview is drawn.
+ *
+ */
+
+#ifndef WILDFIRE_SUMMARY_H
+#define WILDFIRE_SUMMARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+
+#define SUMMARY_TILE 16 ///< rows and columns of cells in a tile of the lowest level
+
+/// Trees in an area of the grid.
+///
+typedef struct {
+    uint64_t cells;   ///< cells of the area
+    uint64_t living;  ///< living trees
+    uint64_t burning; ///< burning trees
+    uint64_t burnt;   ///< burned out trees
+} SummaryCounts;
+
+/// Opaque tree counts of a grid.
+///
+typedef struct Summary Summary;
+
+/// Creates the tree counts of a grid by counting its cells once.
+///
+/// @param g: the grid
+/// @param step: cycles stepped to reach it; sets when its burning trees
+///              burn out
+/// @return the counts, or NULL if memory could not be obtained
+///
+Summary *summary_create( const Grid *g, long step );
+
+/// Releases tree counts. NULL is ignored.
+///
+/// @param s: the counts
+///
+void summary_destroy( Summary *s );
+
+/// Reports a tree catching fire in the step being computed. May be called
+/// from several threads at once.
+///
+/// @param s: the counts
+/// @param r: row of the tree
+/// @param c: column of the tree
+///
+void summary_ignite( Summary *s, size_t r, size_t c );
+
+/// Brings the counts to the next cycle once a step is computed: the trees
+/// reported by summary_ignite catch fire and the trees that caught fire
+/// three steps before burn out.
+///
+/// @param s: the counts
+/// @param step: the step just computed, from 0
+///
+void summary_step( Summary *s, long step );
+
+/// Renumbers the steps of the counts, for a grid that is to go on as a
+/// cycle of another run: step from becomes step to.
+///
+/// @param s: the counts
+/// @param from: cycles stepped to reach the grid, as given so far
+/// @param to: cycles stepped to reach the grid from now on
+///
+void summary_renumber( Summary *s, long from, long to );
+
+/// Counts the trees of a rectangle of the grid. Every tile is counted in
+/// the rectangle holding its first cell, so rectangles that share no
+/// cell share no tile, and counts are exact for rectangles on tile
+/// boundaries. The tiles added are the largest that fit in the
+/// rectangle, so it costs about as many tiles as its edges cross.
+///
+/// @param s: the counts
+/// @param r0: first row
+/// @param c0: first column
+/// @param rows: rows of the rectangle
+/// @param cols: columns of the rectangle
+/// @param out: receives the counts
+///
+void summary_tally( Summary *s, size_t r0, size_t c0, size_t rows, size_t cols,
+                    SummaryCounts *out );
+
+#endif
@@ -0,0 +1,78 @@
+// file: test.c
+// Regression tests of the simulation library: simulations created and
+// destroyed on several threads without a cycle stepped, or after 0 cycles,
+// must not hang. Each case runs under an alarm, which fails it instead.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#define _DEFAULT_SOURCE // must be set before headers
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h> // strlen
+#include <unistd.h> // alarm, write
+
+#include "wildfire.h"
+
+#define CASE_SECONDS 10 ///< a case taking longer is taken to hang
+#define ROUNDS 200 ///< simulations created in each case; the hang was a race
+
+static const char *running = ""; // name of the case running, for the alarm
+
+/// Fails the case running when its alarm goes off.
+/// @param sig the signal
+
+static void hung( int sig ) {
+    (void) sig;
+    const char *why = "hung: ";
+    write( STDERR_FILENO, why, strlen( why ) );
+    write( STDERR_FILENO, running, strlen( running ) );
+    write( STDERR_FILENO, "\n", 1 );
+    _exit( EXIT_FAILURE );
+}
+
+/// Creates and destroys simulations, each stepped a number of cycles.
+/// @param name name of the case
+/// @param engine engine of the simulations
+/// @param threads threads stepping them
+/// @param cycles cycles stepped before they are destroyed; -1 for no call
+/// @return 0 if every simulation was created and stepped, -1 if not
+
+static int lifecycle( const char *name, WildfireEngine engine, int threads, long cycles ) {
+
+    WildfireConfig cfg;
+    wildfire_defaults( &cfg );
+    cfg.width = 70;
+    cfg.height = 50;
+    cfg.engine = engine;
+    cfg.threads = threads;
+
+    running = name;
+    alarm( CASE_SECONDS );
+    int failed = 0;
+    for ( int k = 0; k < ROUNDS && !failed; k++ ) {
+        cfg.seed = (unsigned long) k;
+        Wildfire *w = wildfire_create( &cfg );
+        failed = w == NULL || ( cycles >= 0 && wildfire_step_n( w, cycles ) != cycles );
+        wildfire_destroy( w );
+    }
+    alarm( 0 );
+    printf( "%s %s\n", failed ? "FAIL" : "ok  ", name );
+    return failed ? -1 : 0;
+}
+
+int main( void ) {
+
+    signal( SIGALRM, hung );
+    int failed = 0;
+    failed |= lifecycle( "dense, 1 thread, created and destroyed", WILDFIRE_DENSE, 1, -1 );
+    failed |= lifecycle( "dense, 2 threads, created and destroyed", WILDFIRE_DENSE, 2, -1 );
+    failed |= lifecycle( "dense, 8 threads, created and destroyed", WILDFIRE_DENSE, 8, -1 );
+    failed |= lifecycle( "dense, 2 threads, 0 cycles", WILDFIRE_DENSE, 2, 0 );
+    failed |= lifecycle( "dense, 4 threads, 1 cycle", WILDFIRE_DENSE, 4, 1 );
+    failed |= lifecycle( "sparse, 3 threads, 0 cycles", WILDFIRE_SPARSE, 3, 0 );
+    failed |= lifecycle( "packed, 2 threads, 0 cycles", WILDFIRE_PACKED, 2, 0 );
+    failed |= lifecycle( "tiled, 2 threads, 0 cycles", WILDFIRE_TILED, 2, 0 );
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
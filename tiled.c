@@ -0,0 +1,290 @@
+// file: tiled.c
+// Tiled grids whose quiescent tiles are skipped.
+// author: wor3835 | wor3835@rit.edu
+//
+
+#include <stdlib.h>
+#include <string.h> // memcpy, memset
+
+#include "prof.h"
+#include "rng.h"
+#include "tiled.h"
+
+/// Distance between the rows of a tile buffer, halo included.
+#define TILE_STRIDE ( ( TILE_SIZE + 2 * GRID_HALO + 15 ) & ~15 )
+
+/// Bytes in a tile buffer.
+#define TILE_BYTES ( TILE_STRIDE * ( TILE_SIZE + 2 * GRID_HALO ) )
+
+/// One tile of the grid, with the two cycles of its cells.
+
+typedef struct {
+    cell_t *buffer[2]; // the two cycles, halo included
+    int cur;           // buffer holding the current cycle
+    size_t rows;       // rows of cells; TILE_SIZE but at the bottom edge
+    size_t cols;       // columns of cells; TILE_SIZE but at the right edge
+    long burning;      // burning trees in the current cycle
+    long burningNext;  // burning trees in the next cycle, once stepped
+    int stepped;       // 1 if the next cycle was computed
+} Tile;
+
+struct Tiled {
+    size_t width;   // number of cells in a row
+    size_t height;  // number of rows
+    size_t across;  // tiles in a row of tiles
+    size_t down;    // rows of tiles
+    Tile *tiles;    // row-major
+    cell_t *memory; // all tile buffers
+    size_t active;  // tiles stepped in the last cycle
+};
+
+/// Returns the first cell of row r of a tile buffer.
+
+static inline cell_t *tileRow( cell_t *buffer, size_t r ) {
+    return buffer + ( GRID_HALO + r ) * TILE_STRIDE + GRID_HALO;
+}
+
+/// Returns the current cycle of a tile.
+
+static inline cell_t *current( const Tile *tile ) {
+    return tile->buffer[tile->cur];
+}
+
+/// Creates a tiled grid, all empty.
+
+Tiled *tiled_create( size_t width, size_t height ) {
+
+    Tiled *t = calloc( 1, sizeof (Tiled) );
+    if ( t == NULL ) {
+        return NULL;
+    }
+    t->width = width;
+    t->height = height;
+    t->across = ( width + TILE_SIZE - 1 ) / TILE_SIZE;
+    t->down = ( height + TILE_SIZE - 1 ) / TILE_SIZE;
+
+    size_t count = t->across * t->down;
+    t->tiles = calloc( count, sizeof (Tile) );
+    t->memory = calloc( count * 2, TILE_BYTES );
+    if ( t->tiles == NULL || t->memory == NULL ) {
+        tiled_destroy( t );
+        return NULL;
+    }
+
+    for ( size_t i = 0; i < count; i++ ) {
+        Tile *tile = &t->tiles[i];
+        size_t r0 = i / t->across * TILE_SIZE;
+        size_t c0 = i % t->across * TILE_SIZE;
+        tile->buffer[0] = t->memory + 2 * i * TILE_BYTES;
+        tile->buffer[1] = tile->buffer[0] + TILE_BYTES;
+        tile->rows = height - r0 < TILE_SIZE ? height - r0 : TILE_SIZE;
+        tile->cols = width - c0 < TILE_SIZE ? width - c0 : TILE_SIZE;
+    }
+    return t;
+}
+
+/// Releases a tiled grid. NULL is ignored.
+
+void tiled_destroy( Tiled *t ) {
+    if ( t == NULL ) {
+        return;
+    }
+    free( t->tiles );
+    free( t->memory );
+    free( t );
+}
+
+/// Copies a byte grid into the current cycle and counts the burning trees.
+
+void tiled_pack( Tiled *t, const Grid *g ) {
+    for ( size_t i = 0; i < t->across * t->down; i++ ) {
+        Tile *tile = &t->tiles[i];
+        size_t r0 = i / t->across * TILE_SIZE;
+        size_t c0 = i % t->across * TILE_SIZE;
+        tile->burning = 0;
+        for ( size_t r = 0; r < tile->rows; r++ ) {
+            const cell_t *in = grid_row( g, r0 + r ) + c0;
+            memcpy( tileRow( current( tile ), r ), in, tile->cols );
+            for ( size_t c = 0; c < tile->cols; c++ ) {
+                tile->burning += ( in[c] & CELL_FIRE ) != 0;
+            }
+        }
+    }
+}
+
+/// Copies the current cycle into a byte grid.
+
+void tiled_unpack( const Tiled *t, Grid *g ) {
+    for ( size_t i = 0; i < t->across * t->down; i++ ) {
+        const Tile *tile = &t->tiles[i];
+        size_t r0 = i / t->across * TILE_SIZE;
+        size_t c0 = i % t->across * TILE_SIZE;
+        for ( size_t r = 0; r < tile->rows; r++ ) {
+            memcpy( grid_row( g, r0 + r ) + c0, tileRow( current( tile ), r ), tile->cols );
+        }
+    }
+}
+
+/// Copies n cells of row r of the current cycle, starting at column c,
+/// across as many tiles as they span. Cells outside the grid are empty.
+
+static void fetch( const Tiled *t, ptrdiff_t r, ptrdiff_t c, size_t n, cell_t *dst ) {
+
+    if ( r < 0 || (size_t) r >= t->height ) {
+        memset( dst, CELL_EMPTY, n );
+        return;
+    }
+    const Tile *band = &t->tiles[(size_t) r / TILE_SIZE * t->across];
+    size_t row = (size_t) r % TILE_SIZE;
+
+    while ( n > 0 ) {
+        if ( c < 0 || (size_t) c >= t->width ) {
+            *dst++ = CELL_EMPTY;
+            c++;
+            n--;
+            continue;
+        }
+        const Tile *tile = &band[(size_t) c / TILE_SIZE];
+        size_t col = (size_t) c % TILE_SIZE;
+        size_t m = tile->cols - col < n ? tile->cols - col : n;
+        memcpy( dst, tileRow( current( tile ), row ) + col, m );
+        dst += m;
+        c += (ptrdiff_t) m;
+        n -= m;
+    }
+}
+
+/// Copies cells of one row of the current cycle.
+
+void tiled_cells( const Tiled *t, size_t r, size_t c, size_t n, cell_t *dst ) {
+    fetch( t, (ptrdiff_t) r, (ptrdiff_t) c, n, dst );
+}
+
+/// Fills the halo of the current cycle of a tile from the tiles around it.
+/// The rows above and below may span three tiles and go through fetch; the
+/// columns on either side are copied straight from the tile to the west
+/// and the tile to the east.
+
+static void fillHalo( const Tiled *t, Tile *tile, size_t tr, size_t tc ) {
+
+    cell_t *cells = current( tile );
+    ptrdiff_t top = (ptrdiff_t)( tr * TILE_SIZE );
+    ptrdiff_t left = (ptrdiff_t)( tc * TILE_SIZE );
+    ptrdiff_t rows = (ptrdiff_t) tile->rows;
+    size_t cols = tile->cols;
+    size_t across = cols + 2 * GRID_HALO; // a halo row, corners included
+
+    for ( ptrdiff_t h = 1; h <= GRID_HALO; h++ ) {
+        fetch( t, top - h, left - GRID_HALO, across,
+               tileRow( cells, 0 ) - h * TILE_STRIDE - GRID_HALO );
+        fetch( t, top + rows - 1 + h, left - GRID_HALO, across,
+               tileRow( cells, 0 ) + ( rows - 1 + h ) * TILE_STRIDE - GRID_HALO );
+    }
+
+    const Tile *west = tc > 0 ? tile - 1 : NULL;
+    const Tile *east = tc + 1 < t->across ? tile + 1 : NULL;
+    for ( size_t r = 0; r < tile->rows; r++ ) {
+        cell_t *row = tileRow( cells, r );
+        const cell_t *w = west ? tileRow( current( west ), r ) + TILE_SIZE - GRID_HALO : NULL;
+        const cell_t *e = east ? tileRow( current( east ), r ) : NULL;
+        for ( int h = 0; h < GRID_HALO; h++ ) {
+            row[h - GRID_HALO] = w ? w[h] : CELL_EMPTY;
+            row[cols + h] = e ? e[h] : CELL_EMPTY;
+        }
+    }
+}
+
+/// Returns 1 if a tile or one of the tiles around it has a burning tree.
+
+static int awake( const Tiled *t, size_t tr, size_t tc ) {
+    for ( size_t r = tr > 0 ? tr - 1 : 0; r <= tr + 1 && r < t->down; r++ ) {
+        for ( size_t c = tc > 0 ? tc - 1 : 0; c <= tc + 1 && c < t->across; c++ ) {
+            if ( t->tiles[r * t->across + c].burning > 0 ) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/// Computes the next cycle of the tiles whose first row is in [from, to).
+
+void tiled_rows( Tiled *t, size_t from, size_t to, RowKernel kernel,
+                 const SpreadRule *rule, uint64_t key, uint64_t limit,
+                 size_t *candidates, Summary *summary, long *ignited, long *burnedOut ) {
+
+    long caught = 0;
+    long out = 0;
+    size_t draws = 0;     // counted for the profile only
+    size_t evaluated = 0; // cells of the tiles stepped, for the profile
+    size_t skipped = 0;   // cells of the quiescent tiles, for the profile
+
+    for ( size_t tr = ( from + TILE_SIZE - 1 ) / TILE_SIZE; tr * TILE_SIZE < to; tr++ ) {
+        for ( size_t tc = 0; tc < t->across; tc++ ) {
+            Tile *tile = &t->tiles[tr * t->across + tc];
+            if ( !awake( t, tr, tc ) ) {
+                skipped += tile->rows * tile->cols;
+                continue; // quiescent: the current cycle is also the next
+            }
+
+            size_t r0 = tr * TILE_SIZE;
+            size_t c0 = tc * TILE_SIZE;
+            fillHalo( t, tile, tr, tc );
+
+            cell_t *src = current( tile );
+            cell_t *dst = tile->buffer[tile->cur ^ 1];
+            long tileCaught = 0;
+            long tileOut = 0;
+            for ( size_t r = 0; r < tile->rows; r++ ) {
+                size_t count;
+                cell_t *row = tileRow( dst, r );
+                tileOut += kernel( tileRow( src, r ), TILE_STRIDE, row, tile->cols,
+                                   rule, candidates, &count );
+                draws += count;
+                for ( size_t k = 0; k < count; k++ ) {
+                    uint64_t index = (uint64_t)( r0 + r ) * t->width + c0 + candidates[k];
+                    if ( rng_draw( key, index ) < limit ) {
+                        row[candidates[k]] = CELL_BURN0;
+                        tileCaught++;
+                        if ( summary != NULL ) {
+                            summary_ignite( summary, r0 + r, c0 + candidates[k] );
+                        }
+                    }
+                }
+            }
+
+            tile->burningNext = tile->burning + tileCaught - tileOut;
+            tile->stepped = 1;
+            evaluated += tile->rows * tile->cols;
+            caught += tileCaught;
+            out += tileOut;
+        }
+    }
+
+    PROF_COUNT( PROF_RNG_DRAWS, draws );
+    PROF_COUNT( PROF_EVALUATED, evaluated );
+    PROF_COUNT( PROF_SKIPPED, skipped );
+    *ignited = caught;
+    *burnedOut = out;
+}
+
+/// Makes the next cycle of the stepped tiles current.
+
+void tiled_swap( Tiled *t ) {
+    t->active = 0;
+    for ( size_t i = 0; i < t->across * t->down; i++ ) {
+        Tile *tile = &t->tiles[i];
+        if ( tile->stepped ) {
+            tile->cur ^= 1;
+            tile->burning = tile->burningNext;
+            tile->stepped = 0;
+            t->active++;
+        }
+    }
+}
+
+/// Returns the number of tiles stepped in the last cycle.
+
+size_t tiled_active( const Tiled *t ) {
+    return t->active;
+}
@@ -0,0 +1,111 @@
+/*
+ * File:    tiled.h
+ *
+ * Author:  William Raffaelle
+ *
+ * Description:
+ *      Cache-blocked grid storage. The grid is cut into square tiles of
+ * TILE_SIZE x TILE_SIZE cells, and each tile is stored on its own, with
+ * a halo, in two buffers: the current cycle and the next one. A tile
+ * and its halo fit in the L1 cache, so stepping it with the row
+ * kernels (see kernel.h) reads every byte once, whatever the width of
+ * the grid.
+ *      Each tile counts its burning trees. Only burning trees change on
+ * their own and only trees next to them can catch fire, so a tile with
+ * no burning tree in it or in the tiles around it is quiescent: whether
+ * it is empty, all living trees or burned out, it is skipped entirely
+ * and keeps its buffer from the previous cycle. Draws are keyed by the
+ * cell index in the whole grid, so the result is the same as the other
+ * engines, cell for cell.
+ *
+ */
+
+#ifndef WILDFIRE_TILED_H
+#define WILDFIRE_TILED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "grid.h"
+#include "kernel.h"
+#include "summary.h"
+
+#define TILE_SIZE 64 ///< rows and columns of cells in a tile
+
+/// Opaque tiled grid holding the current and the next cycle.
+///
+typedef struct Tiled Tiled;
+
+/// Creates a tiled grid of the given dimensions, all empty.
+///
+/// @param width: number of cells in a row
+/// @param height: number of rows
+/// @return the grid, or NULL if memory could not be obtained
+///
+Tiled *tiled_create( size_t width, size_t height );
+
+/// Releases a tiled grid. NULL is ignored.
+///
+/// @param t: the grid
+///
+void tiled_destroy( Tiled *t );
+
+/// Copies a byte grid of the same dimensions into the current cycle.
+///
+/// @param t: the tiled grid
+/// @param g: grid to be copied
+///
+void tiled_pack( Tiled *t, const Grid *g );
+
+/// Copies the current cycle into a byte grid of the same dimensions.
+///
+/// @param t: the tiled grid
+/// @param g: grid to be overwritten
+///
+void tiled_unpack( const Tiled *t, Grid *g );
+
+/// Copies cells of one row of the current cycle, across as many tiles as
+/// they span.
+///
+/// @param t: the tiled grid
+/// @param r: the row
+/// @param c: first column
+/// @param n: number of cells, all in the grid
+/// @param dst: receives the cells
+///
+void tiled_cells( const Tiled *t, size_t r, size_t c, size_t n, cell_t *dst );
+
+/// Computes the next cycle of the tiles whose first row is in [from, to),
+/// skipping the quiescent ones. Bands of rows may be stepped by different
+/// threads at once.
+///
+/// @param t: the tiled grid
+/// @param from: first row
+/// @param to: one past the last row
+/// @param kernel: row kernel stepping the tiles
+/// @param rule: neighbor sums that spread fire
+/// @param key: key of the random stream of this cycle
+/// @param limit: a draw under this limit catches fire
+/// @param candidates: room for TILE_SIZE columns
+/// @param summary: told of every tree that catches fire; NULL for none
+/// @param ignited: receives the number of trees that caught fire
+/// @param burnedOut: receives the number of trees that burned out
+///
+void tiled_rows( Tiled *t, size_t from, size_t to, RowKernel kernel,
+                 const SpreadRule *rule, uint64_t key, uint64_t limit,
+                 size_t *candidates, Summary *summary, long *ignited, long *burnedOut );
+
+/// Makes the next cycle of the stepped tiles current, once all bands
+/// are done.
+///
+/// @param t: the tiled grid
+///
+void tiled_swap( Tiled *t );
+
+/// Returns the number of tiles stepped in the last cycle.
+///
+/// @param t: the tiled grid
+///
+size_t tiled_active( const Tiled *t );
+
+#endif
@@ -1,24 +1,25 @@
 // file: wildfire.c
-// Implements the simulation of spreading fire. The program implements
-// a combination of [Shiflet] Assignents with variations. The state of 
-// the system is repeatedly computed and displayed to show the progression
-// of a forest fire. Each state represents the start of a new cycle. The simulation
-// is represented by a grid of cells. Cursor-control functions are used to show changes
-// to the grid as the fire spreads. The optional print mode prints another grid for
-// each simulation cycle.  
+// Implements the simulation of spreading fire. The state of the system is
+// repeatedly computed from the previous one. Each state represents the start
+// of a new cycle. The simulation is represented by a grid of cells, held with
+// everything else about a run in a Wildfire context (see wildfire.h).
 // author: wor3835 | wor3835@rit.edu
 //
 
-#define _BSD_SOURCE // must be set before headers 
+#define _DEFAULT_SOURCE // must be set before headers
 
-#include <unistd.h> // usleep
-#include <stdio.h>
+#include <pthread.h> // worker threads for row bands
+#include <stdint.h>
 #include <stdlib.h>
-#include <string.h> // memcpy, strcpy
-#include <getopt.h> // processes command line arguments that begin with (-) 
-#include "display.h" // display cursor
-//#include "wildfire.h" 
-#include <limits.h> 
+#include <string.h> // memcpy, memset
+#include "wildfire.h" // the interface implemented here
+#include "rng.h" // counter-based random numbers
+#include "sparse.h" // active-front stepping
+#include "packed.h" // four bits per cell stepping
+#include "tiled.h" // cache-blocked stepping
+#include "counted.h" // incremental stepping
+#include "summary.h" // tree counts per tile
+#include "prof.h" // optional instrumentation
 
 // default values for simulation
 
@@ -26,470 +27,818 @@
 #define DEFAULT_PROB_CATCH 0.30 // default pCatch
 #define DEFAULT_DENSITY 0.50 // default density
 #define DEFAULT_PROP_NEIGHBOR 0.25 // default pNeighbor
-#define DEFAULT_PRINT_COUNT 0 // print mode is turned off and overlay display mode is on
 #define DEFAULT_SIZE 10 // default size
+#define DEFAULT_SEED 41 // default random seed
+#define DEFAULT_THREADS 1 // default number of threads stepping the grid
+
+#define SPARSE_RATIO 64 // the sparse engine steps densely above 1/64 of the cells burning
+#define BLOCK_ROWS 128 // rows of a tile advanced several cycles at once
+#define BLOCK_SPAN 512 // columns of a tile and its margins; a whole number of vectors
+
+/// A band of rows stepped by one thread, with the counts of that thread.
+/// The counts are added to the counters of the simulation after each cycle.
+
+typedef struct {
+    Wildfire *w; // simulation the band belongs to
+    pthread_t thread; // thread stepping the band; unused for band 0
+    size_t from; // first row of the band
+    size_t to; // one past the last row of the band
+    size_t *candidates; // columns of trees that may catch fire
+    long ignited; // trees that caught fire in the band this cycle
+    long burnedOut; // trees that burned out in the band this cycle
+    Grid *block[2]; // a tile and its margin at two cycles, for temporal blocking
+    long *ignitedAt; // trees that caught fire in the band at each cycle of a block
+    long *burnedOutAt; // trees that burned out in the band at each cycle of a block
+} Band;
+
+struct Wildfire {
+    size_t width; // number of columns in the grid
+    size_t height; // number of rows in the grid
+    unsigned long seed; // seed of the random number streams
+    WildfireEngine engine; // how each cycle is stepped
+    int threads; // number of threads stepping the grid
+    int timeBlock; // most cycles a tile of the dense engine advances per pass
+    int blockCycles; // cycles of the pass being stepped; 1 steps a cycle at a time
+    RowKernel stepRow; // computes one row of update; specialized for rule
+    Neighborhood hood; // cells whose burning trees spread fire
+    int threshold; // burning neighbors that spread fire; 0 for the ratio rule
+    SpreadRule rule; // neighbor counts that spread fire
+    uint64_t catchLimit; // a draw under this limit catches fire; from pCatch
+    WildfireCounters counters; // step, changes and trees
+
+    Grid *grid; // current cycle; for the packed and tiled engines, a copy of it
+    Grid *next; // next cycle; swapped with grid by the dense and sparse engines
+    long gridStep; // step written into grid by the packed, tiled and counted engines
+    Front *front; // burning trees, for the sparse engine
+    int frontStale; // 1 if front does not describe the current grid
+    Packed *packed; // both cycles, for the packed engine
+    Tiled *tiled; // both cycles, for the tiled engine
+    Counted *counted; // neighbor counts, for the counted engine
+    Summary *summary; // tree counts per tile; NULL unless configured
+
+    Band *bands; // one band per thread
+    pthread_barrier_t startLine; // threads wait here for a cycle to step
+    pthread_barrier_t finishLine; // threads wait here for the cycle to finish
+    pthread_mutex_t starting; // held while the threads are started
+    int running; // 1 once the threads past band 0 are running
+    int quitting; // 1 when the threads should exit; set by stopBands only
+    int unstarted; // 1 if a thread could not be started; set by startBands only
+};
+
+/// Fills a configuration with the defaults of the command line program.
+
+void wildfire_defaults( WildfireConfig *cfg ) {
+    *cfg = (WildfireConfig) {
+        .width = DEFAULT_SIZE, .height = DEFAULT_SIZE,
+        .pCatch = DEFAULT_PROB_CATCH, .density = DEFAULT_DENSITY,
+        .pBurning = DEFAULT_BURN, .pNeighbor = DEFAULT_PROP_NEIGHBOR,
+        .seed = DEFAULT_SEED, .engine = WILDFIRE_DENSE,
+        .threads = DEFAULT_THREADS, .kernel = NULL,
+        .neighborhood = NEIGHBORHOOD_MOORE, .threshold = 0, .timeBlock = 1,
+        .summary = 0, .landscape = NULL,
+    };
+}
 
-#define DEFAULT_TREES 0 // default totalTrees
-#define DEFAULT_FIRE 0 // default fireTrees
-#define DEFAULT_LIVING 0 // default livingTrees
-#define DEFAULT_SPACES 0 // default spaces
-
-//
-
-static size_t size = DEFAULT_SIZE; // size of the grid
+/// Returns the rows and columns a tree's neighbors reach.
 
-static float pCatch = DEFAULT_PROB_CATCH; // probability of a tree catching fire
+static int reach( const Wildfire *w ) {
+    return w->hood == NEIGHBORHOOD_RADIUS2 ? 2 : 1;
+}
 
-static float density = DEFAULT_DENSITY; // density
+/// Computes one span of a row of a tile buffer a cycle ahead, drawing for
+/// the trees that may catch fire with the stream of that cycle. Only the
+/// changes in the cells [lo, hi) of the span belong to the tile and are
+/// counted; the others are computed again by the tiles around.
+/// @param band the band of the tile
+/// @param in first cell of the span in the previous cycle
+/// @param out first cell of the span in the cycle computed
+/// @param stride distance between rows of the tile buffers
+/// @param r row of the span in the grid
+/// @param c column of the first cell of the span in the grid; may be negative
+/// @param n number of cells in the span
+/// @param lo first cell of the span in the tile
+/// @param hi one past the last cell of the span in the tile
+/// @param key key of the random stream of the cycle computed
+/// @param ignited receives the number of trees of the tile that caught fire
+/// @return the number of trees of the tile that burned out
+
+static long blockSpan( Band *band, const cell_t *in, cell_t *out, size_t stride,
+                       ptrdiff_t r, ptrdiff_t c, size_t n, size_t lo, size_t hi,
+                       uint64_t key, long *ignited ) {
+    Wildfire *w = band->w;
+    size_t count;
+    long burnedOut = w->stepRow(in, stride, out, n, &w->rule, band->candidates, &count);
+    for (size_t k = 0; k < count; k++) {
+        size_t j = band->candidates[k];
+        // only cells of the grid hold trees, so the index is never negative
+        size_t col = (size_t)(c + (ptrdiff_t) j);
+        if ( rng_draw(key, (uint64_t) r * w->width + col) < w->catchLimit ) {
+            out[j] = CELL_BURN0;
+            *ignited += j >= lo && j < hi;
+        }
+    }
+    PROF_COUNT(PROF_RNG_DRAWS, count);
+    if ( lo == hi ) {
+        return 0;
+    }
+    for (size_t j = 0; j < lo; j++) {
+        burnedOut -= in[j] == CELL_BURN2;
+    }
+    for (size_t j = hi; j < n; j++) {
+        burnedOut -= in[j] == CELL_BURN2;
+    }
+    return burnedOut;
+}
 
-static float pBurning = DEFAULT_BURN; // proportion of the tree population initially on fire
+/// Advances one tile of the grid w->blockCycles cycles at once, from grid
+/// into next. The tile is copied into a buffer with a margin of reach cells
+/// for each cycle, cells beyond the grid being empty. Every cycle computes
+/// rows one reach fewer above and below than the one before, so the last
+/// one computes exactly the rows of the tile; the rows are always computed
+/// whole, so the kernels never step a short tail. A cell whose inputs were
+/// not all valid is never read by one that is: the valid cells of each
+/// cycle also shrink one reach from each side. The margins are computed
+/// again by the tiles around; only the changes inside the tile are counted,
+/// per cycle, in the band.
+/// @param band the band of the tile; receives the counts of each cycle
+/// @param r0 first row of the tile
+/// @param c0 first column of the tile
+/// @param rows number of rows in the tile
+/// @param cols number of columns in the tile
+
+static void blockTile( Band *band, size_t r0, size_t c0, size_t rows, size_t cols ) {
+
+    Wildfire *w = band->w;
+    const int k = w->blockCycles;
+    const size_t reaches = (size_t) reach(w);
+    const size_t m = (size_t) k * reaches; // margin of the tile at the first cycle
+    const ptrdiff_t top = (ptrdiff_t) r0 - (ptrdiff_t) m; // grid row of buffer row 0
+    const ptrdiff_t left = (ptrdiff_t) c0 - (ptrdiff_t) m; // grid column of buffer column 0
+
+    Grid *buf = band->block[0];
+    for (size_t i = 0; i < rows + 2 * m; i++) {
+        ptrdiff_t r = top + (ptrdiff_t) i;
+        cell_t *row = grid_row(buf, i);
+        memset(row, CELL_EMPTY, cols + 2 * m);
+        if ( r >= 0 && r < (ptrdiff_t) w->height ) {
+            ptrdiff_t from = left < 0 ? -left : 0; // first buffer column in the grid
+            ptrdiff_t to = (ptrdiff_t) w->width - left; // past the last one
+            to = to < (ptrdiff_t)(cols + 2 * m) ? to : (ptrdiff_t)(cols + 2 * m);
+            memcpy(row + from, grid_row(w->grid, (size_t) r) + left + from, (size_t)(to - from));
+        }
+    }
 
-static float pNeighbor = DEFAULT_PROP_NEIGHBOR; // proportion of neighbors that will influence a tree catching fire
+    size_t evaluated = 0; // counted for the profile only
+    for (int j = 1; j <= k; j++) {
+        const Grid *src = band->block[(j - 1) & 1];
+        Grid *dst = band->block[j & 1];
+        uint64_t key = rng_key(w->seed, w->counters.step + j - 1);
+        size_t e = m - (size_t) j * reaches; // rows computed above and below the tile
+        long ignited = 0;
+        long burnedOut = 0;
+
+        for (size_t i = m - e; i < m + rows + e; i++) {
+            int inside = i >= m && i < m + rows; // a row of the tile itself
+            burnedOut += blockSpan(band, grid_row(src, i), grid_row(dst, i), src->stride,
+                                   top + (ptrdiff_t) i, left, cols + 2 * m,
+                                   inside ? m : 0, inside ? m + cols : 0, key, &ignited);
+        }
+        band->ignitedAt[j - 1] += ignited;
+        band->burnedOutAt[j - 1] += burnedOut;
+        evaluated += (rows + 2 * e) * (cols + 2 * m);
+    }
+    PROF_COUNT(PROF_EVALUATED, evaluated);
 
-static int print = DEFAULT_PRINT_COUNT; // print mode; 1 if on, 0 if off
+    const Grid *last = band->block[k & 1];
+    for (size_t i = 0; i < rows; i++) {
+        memcpy(grid_row(w->next, r0 + i) + c0, grid_row(last, m + i) + m, cols);
+    }
+}
 
-static int cycle = INT_MAX; // cycle of simulation
+/// Advances rows [band->from, band->to) w->blockCycles cycles, one tile at
+/// a time, counting the changes of each cycle in band->ignitedAt and
+/// band->burnedOutAt.
 
-static int changes = 0; // number of changes in most recent cycle
+static void blockBand( Band *band ) {
+    Wildfire *w = band->w;
+    for (int j = 0; j < w->blockCycles; j++) {
+        band->ignitedAt[j] = 0;
+        band->burnedOutAt[j] = 0;
+    }
+    size_t span = BLOCK_SPAN - 2 * (size_t) w->blockCycles * (size_t) reach(w); // tile columns
+    for (size_t r = band->from; r < band->to; r += BLOCK_ROWS) {
+        size_t rows = band->to - r < BLOCK_ROWS ? band->to - r : BLOCK_ROWS;
+        for (size_t c = 0; c < w->width; c += span) {
+            size_t cols = w->width - c < span ? w->width - c : span;
+            blockTile(band, r, c, rows, cols);
+        }
+    }
+}
 
-static int cChanges = 0; // cumulative number of changes of all cycles
+/// Computes rows [band->from, band->to) of the next cycle. The row kernel
+/// computes each row of dst from src at once, advancing burning trees and
+/// finding the living trees with enough burning neighbors; those catch fire
+/// with probability pCatch. Every tree's draw is keyed by the seed, the
+/// cycle and the tree's cell index, so the result does not depend on which
+/// thread steps the row or in what order.
+/// @param band the rows to compute; receives the counts of the band
 
-static int totalTrees = DEFAULT_TREES; // total number of trees  
+static void updateBand( Band *band ) {
 
-static int fireTrees = DEFAULT_FIRE; // total number of trees on fire
+    Wildfire *w = band->w;
+    size_t r;
+    size_t k;
+    size_t count; // number of trees that may catch fire in the row
 
-static int livingTrees = DEFAULT_LIVING; // total number of living trees
+    uint64_t key = rng_key(w->seed, w->counters.step); // stream of this cycle
 
-static int spaces = DEFAULT_SPACES; // total number of spaces in grid
+    if ( w->blockCycles > 1 ) {
+        blockBand(band);
+        return;
+    }
 
-// function declarations //
-static int applySpread(int row, int col, char copy[size][size]);
-static void help();
-static void update( char g[size][size] );
-static void shuffle( long size, char data[]);
-int main( int argc, char * argv[] );
+    if ( w->engine == WILDFIRE_PACKED ) {
+        packed_rows(w->packed, band->from, band->to, &w->rule, key, w->catchLimit, w->summary,
+                    &band->ignited, &band->burnedOut);
+        return;
+    }
 
-/// help function gives instructions. Prints usage information to stderr.
+    if ( w->engine == WILDFIRE_TILED ) {
+        tiled_rows(w->tiled, band->from, band->to, w->stepRow, &w->rule, key, w->catchLimit,
+                   band->candidates, w->summary, &band->ignited, &band->burnedOut);
+        return;
+    }
 
-static void help() {
-    fprintf( stderr, "usage: wildfire [options]\n" );
-    fprintf( stderr, "By default, the simulation runs in overlay display mode.\n" );
-    fprintf( stderr, "The -pN option makes the simulation run in print mode for up to N cycles.\n" );
-    printf("\n");
-    fprintf( stderr, "Simulation Configuration Options:\n" );
-    fprintf( stderr, " -H # View simulation options and quit.\n" ); 
-    fprintf( stderr, " -bN # proportion of trees that are already burning. 0 < N < 101.\n" );
-    fprintf( stderr, " -cN # probability that a tree will catch fire. 0 < N < 101.\n" );
-    fprintf( stderr, " -dN # density/proportion of trees in the grid. 0 < N < 101.\n" );
-    fprintf( stderr, " -nN # proportion of neighbors that influence a tree catching fire. -1 < N < 101.\n" );
-    fprintf( stderr, " -pN # number of cycles to print before quitting. -1 < N < ...\n" );
-    fprintf( stderr, " -sN # simulation grid size. 4 < N < 41.\n" );
-    printf("\n");
-    printf("\n");
-    exit(0);
+    const Grid *src = w->grid;
+    Grid *dst = w->next;
+    band->ignited = 0;
+    band->burnedOut = 0;
+    size_t draws = 0; // counted for the profile only
+
+    for (r = band->from; r < band->to; r++) {
+        cell_t *out = grid_row(dst, r);
+        band->burnedOut += w->stepRow(grid_row(src, r), src->stride, out, w->width,
+                                      &w->rule, band->candidates, &count);
+        draws += count;
+        for (k = 0; k < count; k++) {
+            if ( rng_draw(key, (uint64_t) r * w->width + band->candidates[k]) < w->catchLimit ) {
+                out[band->candidates[k]] = CELL_BURN0; // becomes burning in next grid
+                band->ignited++;
+                if ( w->summary != NULL ) {
+                    summary_ignite(w->summary, r, band->candidates[k]);
+                }
+            }
+        }
+    }
+    PROF_COUNT(PROF_RNG_DRAWS, draws);
+    PROF_COUNT(PROF_EVALUATED, (band->to - band->from) * w->width);
 }
 
-/// Modifies the grid in place. Applies spread function to 
-/// each cell.
-/// Changes any burning tree to a 0,1,2 or 3 to represent
-/// its current cycle. These numbers are ignored when the grid
-/// is printed. The function handles the 2-cycle burn for trees that burn.   
- 
-static void update( char g[size][size] ) {
-   
-    int s = size;
-
-    char cpy[s][s];
-    memcpy(cpy, g, sizeof (char) * s * s); // makes copy of 2D array 
-
-    int r;
-    int c;
-
-    int ret; // return value of spread (1 if tree starts burning)
-
-    for (r = 0; r < s; r++) {
-        for (c = 0; c < s; c++) {    
-	    if ( cpy[r][c] == 'Y' ) {
-	        ret = applySpread(r, c, cpy);
-		if ( ret == 1 ) {
-		    g[r][c] = '0'; // becomes burning in actual grid
-		    changes++;
-		    fireTrees++;
-		    livingTrees--;
-		}
-	    }
-	    else if ( cpy[r][c] == '*' ) {
-		g[r][c] = '0';
-	    }
-	    else if ( cpy[r][c] == '0' ) {
-		g[r][c] = '1'; // first cycle
-	    }
-	    else if ( cpy[r][c] == '1' ) {
-		g[r][c] = '2'; // second cycle 
-	    }
-	    else if ( cpy[r][c] == '2' ) {
-		g[r][c] = '.'; // third cycle
-		changes++;
-		totalTrees--;
-		fireTrees--;
-	    }
+/// Body of the threads stepping bands 1 and up. A thread first waits for
+/// startBands to have started all of them, then each cycle it waits at the
+/// start line, steps its band and waits at the finish line.
+
+static void *bandThread( void *arg ) {
+    Band *band = arg;
+    Wildfire *w = band->w;
+    pthread_mutex_lock(&w->starting);
+    int failed = w->unstarted; // another thread could not be started
+    pthread_mutex_unlock(&w->starting);
+    if ( failed ) {
+        return NULL;
+    }
+    for (;;) {
+        pthread_barrier_wait(&w->startLine);
+        if ( w->quitting ) {
+            return NULL;
         }
+        updateBand(band);
+        pthread_barrier_wait(&w->finishLine);
     }
 }
 
-/// Implements the spread algorithm. Function handles 8-way connectivity of neighbors. The 2-cycle
-/// burn for burning trees is handled in update. 
+/// Splits the grid into one band of rows per thread and starts the threads.
+/// The calling thread steps band 0. The threads are held back until all of
+/// them are started, so if one cannot be, the others quit before reaching
+/// the barriers. That is told by a flag of its own: a thread may look only
+/// once stopBands has set quitting, and must still meet it at the start
+/// line then.
+/// @return 0 on success, -1 if memory or threads could not be obtained
 
-static int applySpread(int row, int col, char copy[size][size]) {
-	
-    int totalNeighbors = 0; // total neighbors of tree 
-    int burningNeighbors =  0; // total tree neighbors of tree
+static int startBands( Wildfire *w ) {
 
-    int tmpsize = size;
+    if ( (size_t) w->threads > w->height ) {
+        w->threads = (int) w->height; // every band has at least one row
+    }
 
-    if ( ( row - 1 >= 0 ) ) { // north neighbor
-	if ( ( copy[row - 1][col] == 'Y' || copy[row - 1][col] == '*' 
-		|| copy[row - 1][col] == '0' || copy[row - 1][col] == '1' || copy[row - 1][col] == '2') ) {
-	    totalNeighbors++;
-	}
-	if ( ( copy[row - 1][col] == '*' || copy[row - 1][col] == '0' || copy[row - 1][col] == '1'
-		|| copy[row - 1][col] == '2') ) {
-	    burningNeighbors++;
-	}
+    w->bands = calloc(w->threads, sizeof (Band));
+    if ( w->bands == NULL ) {
+        return -1;
     }
 
-    if ( ( col + 1 < tmpsize ) ) { // east neighbor
-        if ( ( copy[row][col + 1] == 'Y' || copy[row][col + 1] == '*'
-                || copy[row][col + 1] == '0' || copy[row][col + 1] == '1' || copy[row][col + 1] == '2') ) {
-            totalNeighbors++;
+    size_t margin = (size_t) w->timeBlock * (size_t) reach(w); // of a tile blocked in time
+    for (int t = 0; t < w->threads; t++) {
+        Band *band = &w->bands[t];
+        band->w = w;
+        band->from = w->height * t / w->threads;
+        band->to = w->height * (t + 1) / w->threads;
+        band->candidates = malloc((w->width + 2 * margin) * sizeof (size_t));
+        if ( band->candidates == NULL ) {
+            return -1;
         }
-        if ( ( copy[row][col + 1] == '*' || copy[row][col + 1] == '0' || copy[row][col + 1] == '1'
-                || copy[row][col + 1] == '2') ) {
-            burningNeighbors++;
+        if ( w->timeBlock > 1 ) {
+            band->block[0] = grid_create(BLOCK_SPAN, BLOCK_ROWS + 2 * margin);
+            band->block[1] = grid_create(BLOCK_SPAN, BLOCK_ROWS + 2 * margin);
+            band->ignitedAt = malloc(w->timeBlock * sizeof (long));
+            band->burnedOutAt = malloc(w->timeBlock * sizeof (long));
+            if ( band->block[0] == NULL || band->block[1] == NULL
+                 || band->ignitedAt == NULL || band->burnedOutAt == NULL ) {
+                return -1;
+            }
         }
     }
 
+    if ( w->threads == 1 ) {
+        return 0;
+    }
+
+    pthread_barrier_init(&w->startLine, NULL, w->threads);
+    pthread_barrier_init(&w->finishLine, NULL, w->threads);
+    pthread_mutex_init(&w->starting, NULL);
+    pthread_mutex_lock(&w->starting);
+    int started = 1;
+    while ( started < w->threads
+            && pthread_create(&w->bands[started].thread, NULL, bandThread, &w->bands[started]) == 0 ) {
+        started++;
+    }
+    w->unstarted = started < w->threads;
+    pthread_mutex_unlock(&w->starting);
 
-    if ( ( row + 1 < tmpsize) ) { // south neighbor
-        if ( ( copy[row + 1][col] == 'Y' || copy[row + 1][col] == '*'
-                || copy[row + 1][col] == '0' || copy[row + 1][col] == '1' || copy[row + 1][col] == '2') ) {
-            totalNeighbors++;
+    if ( w->unstarted ) {
+        for (int t = 1; t < started; t++) {
+            pthread_join(w->bands[t].thread, NULL);
         }
-        if ( ( copy[row + 1][col] == '*' || copy[row + 1][col] == '0' || copy[row + 1][col] == '1'
-                || copy[row + 1][col] == '2') ) {
-            burningNeighbors++;
+        pthread_barrier_destroy(&w->startLine);
+        pthread_barrier_destroy(&w->finishLine);
+        pthread_mutex_destroy(&w->starting);
+        return -1;
+    }
+    w->running = 1;
+    return 0;
+}
+
+/// Stops the threads and releases the bands.
+
+static void stopBands( Wildfire *w ) {
+    if ( w->bands == NULL ) {
+        return;
+    }
+    if ( w->running ) {
+        w->quitting = 1;
+        pthread_barrier_wait(&w->startLine);
+        for (int t = 1; t < w->threads; t++) {
+            pthread_join(w->bands[t].thread, NULL);
         }
+        pthread_barrier_destroy(&w->startLine);
+        pthread_barrier_destroy(&w->finishLine);
+        pthread_mutex_destroy(&w->starting);
     }
+    for (int t = 0; t < w->threads; t++) {
+        free(w->bands[t].candidates);
+        grid_destroy(w->bands[t].block[0]);
+        grid_destroy(w->bands[t].block[1]);
+        free(w->bands[t].ignitedAt);
+        free(w->bands[t].burnedOutAt);
+    }
+    free(w->bands);
+    w->bands = NULL;
+}
+
+/// Adds the trees that caught fire and burned out in a cycle to the counters.
+/// @param ignited number of trees that caught fire
+/// @param burnedOut number of trees that burned out
+
+static void tally( Wildfire *w, long ignited, long burnedOut ) {
+    WildfireCounters *c = &w->counters;
+    c->changes += ignited + burnedOut;
+    c->fireTrees += ignited - burnedOut;
+    c->livingTrees -= ignited;
+    c->totalTrees -= burnedOut;
+}
 
+/// Has every thread step its band of rows, and waits for all of them.
 
-    if ( ( col - 1 >= 0 ) ) { // west neighbor 
-        if ( ( copy[row][col - 1] == 'Y' || copy[row][col - 1] == '*'
-                || copy[row][col - 1] == '0' || copy[row][col - 1] == '1' || copy[row][col - 1] == '2') ) {
-            totalNeighbors++;
+static void stepBands( Wildfire *w ) {
+    if ( w->threads > 1 ) {
+        pthread_barrier_wait(&w->startLine);
+        updateBand(&w->bands[0]);
+        pthread_barrier_wait(&w->finishLine);
+    } else {
+        updateBand(&w->bands[0]);
+    }
+}
+
+/// Computes the next cycle of the simulation. Every thread steps its band
+/// of rows, then the counts of the bands are added up in band order. Every
+/// cell of the next cycle is written, so the two grids of the dense engine
+/// can be used as a ping-pong pair without copying between cycles.
+
+static void update( Wildfire *w ) {
+
+    stepBands(w);
+
+    for (int t = 0; t < w->threads; t++) {
+        tally(w, w->bands[t].ignited, w->bands[t].burnedOut);
+    }
+}
+
+/// Counts the trees of cycle 0 in a landscape.
+
+static void census( Wildfire *w, const Grid *g ) {
+    WildfireCounters *c = &w->counters;
+    for (size_t r = 0; r < g->height; r++) {
+        const cell_t *row = grid_row(g, r);
+        for (size_t j = 0; j < g->width; j++) {
+            c->livingTrees += row[j] == CELL_LIVING;
+            c->fireTrees += (row[j] & CELL_FIRE) != 0;
         }
-        if ( ( copy[row][col - 1] == '*' || copy[row][col - 1] == '0' || copy[row][col - 1] == '1'
-                || copy[row][col - 1] == '2') ) {
-            burningNeighbors++;
+    }
+    c->totalTrees = c->livingTrees + c->fireTrees;
+}
+
+/// Sets the counters of cycle 0 from density and pBurning and places that
+/// many trees at random in a grid.
+
+static void plant( Wildfire *w, Grid *grid, float density, float pBurning ) {
+    WildfireCounters *c = &w->counters;
+    size_t area = w->width * w->height; // number of cells in the grid
+    double x = area * (double)density;
+    c->totalTrees = (long)(x + 0.5); // rounds float to integer
+    double y = c->totalTrees * (double)pBurning; // represented by (*)
+    c->fireTrees = (long)(y + 0.5);
+    c->livingTrees = c->totalTrees - c->fireTrees; // represented by (Y)
+    grid_populate(grid, c->livingTrees, c->fireTrees, w->seed); // places trees at random
+}
+
+/// Creates a simulation at cycle 0 and starts the threads stepping it.
+
+Wildfire *wildfire_create( const WildfireConfig *cfg ) {
+
+    Grid *grid = cfg->landscape;
+    Wildfire *w = calloc(1, sizeof (Wildfire));
+    if ( w == NULL ) {
+        grid_destroy(grid);
+        return NULL;
+    }
+    w->width = cfg->width;
+    w->height = cfg->height;
+    w->seed = cfg->seed;
+    w->engine = cfg->engine;
+    w->threads = cfg->threads > 0 && cfg->engine != WILDFIRE_COUNTED ? cfg->threads : 1;
+    w->timeBlock = cfg->engine == WILDFIRE_DENSE && cfg->timeBlock > 1 ? cfg->timeBlock : 1;
+    w->timeBlock = w->timeBlock < WILDFIRE_TIME_BLOCK_MAX ? w->timeBlock : WILDFIRE_TIME_BLOCK_MAX;
+    w->timeBlock = cfg->summary ? 1 : w->timeBlock; // a block would skip the ignitions of its cycles
+    w->blockCycles = 1;
+    w->hood = cfg->neighborhood;
+    w->threshold = cfg->threshold;
+    w->frontStale = 1;
+    w->gridStep = -1;
+    wildfire_configure(w, cfg->pCatch, cfg->pNeighbor);
+    w->stepRow = kernel_specialize(cfg->kernel != NULL ? cfg->kernel : kernel_select(NULL), &w->rule);
+
+    if ( (grid != NULL && (grid->width != w->width || grid->height != w->height))
+         || (w->hood != NEIGHBORHOOD_MOORE
+             && (w->engine == WILDFIRE_SPARSE || w->engine == WILDFIRE_PACKED)) ) {
+        grid_destroy(grid);
+        wildfire_destroy(w);
+        return NULL;
+    }
+
+    WildfireCounters *c = &w->counters;
+    size_t area = w->width * w->height; // number of cells in the grid
+    if ( grid != NULL ) {
+        census(w, grid);
+    } else {
+        grid = grid_create(w->width, w->height);
+        if ( grid != NULL ) {
+            plant(w, grid, cfg->density, cfg->pBurning);
         }
     }
+    c->spaces = (long)area - c->totalTrees; // represented by space character
+    c->initialTrees = c->totalTrees;
+    w->grid = grid;
 
+    if ( grid == NULL || startBands(w) != 0 ) {
+        wildfire_destroy(w);
+        return NULL;
+    }
+    if ( cfg->summary ) {
+        w->summary = summary_create(grid, 0);
+        if ( w->summary == NULL ) {
+            wildfire_destroy(w);
+            return NULL;
+        }
+    }
 
-    if ( ( row - 1 >= 0 && col + 1 < tmpsize ) ) { // northeast neighbor 
-	if ( ( copy[row - 1][col + 1] == 'Y' || copy[row - 1][col + 1] == '*'
-                || copy[row - 1][col + 1] == '0' || copy[row - 1][col + 1] == '1' || copy[row - 1][col + 1] == '2') ) {
-            totalNeighbors++;
+    if ( w->engine == WILDFIRE_PACKED ) {
+        w->packed = packed_create(w->width, w->height);
+        if ( w->packed != NULL ) {
+            packed_pack(w->packed, grid);
+        }
+    } else if ( w->engine == WILDFIRE_TILED ) {
+        w->tiled = tiled_create(w->width, w->height);
+        if ( w->tiled != NULL ) {
+            tiled_pack(w->tiled, grid);
         }
-       if ( ( copy[row - 1][col + 1] == '*' || copy[row - 1][col + 1] == '0' || copy[row - 1][col + 1] == '1'
-                || copy[row - 1][col + 1] == '2') ) {
-            burningNeighbors++;
+    } else if ( w->engine == WILDFIRE_COUNTED ) {
+        // steps grid in place
+        w->counted = counted_create(grid, w->hood);
+        if ( w->counted == NULL ) {
+            wildfire_destroy(w);
+            return NULL;
         }
+        return w;
+    } else {
+        // the sparse engine steps densely while the fire is wide
+        w->next = grid_create(w->width, w->height);
+        w->front = w->engine == WILDFIRE_SPARSE ? front_create() : NULL;
+        if ( w->next == NULL || (w->engine == WILDFIRE_SPARSE && w->front == NULL) ) {
+            wildfire_destroy(w);
+            return NULL;
+        }
+        return w;
     }
 
+    // the packed and tiled engines keep their own cells; a grid is only
+    // made again for wildfire_grid
+    grid_destroy(grid);
+    w->grid = NULL;
+    if ( w->packed == NULL && w->tiled == NULL ) {
+        wildfire_destroy(w);
+        return NULL;
+    }
+    return w;
+}
 
-    if ( ( row + 1 < tmpsize && col + 1 < tmpsize ) ) { // southeast neighbor
-	if ( ( copy[row + 1][col + 1] == 'Y' || copy[row + 1][col + 1] == '*'
-                || copy[row + 1][col + 1] == '0' || copy[row + 1][col + 1] == '1' || copy[row + 1][col + 1] == '2') ) {
-            totalNeighbors++;
-        }
-        if ( ( copy[row + 1][col + 1] == '*' || copy[row + 1][col + 1] == '0' || copy[row + 1][col + 1] == '1'
-                || copy[row + 1][col + 1] == '2') ) {
-            burningNeighbors++;
+/// Changes the spread parameters of a simulation.
+
+void wildfire_configure( Wildfire *w, float pCatch, float pNeighbor ) {
+    if ( w->threshold > 0 ) {
+        kernel_threshold(&w->rule, w->hood, w->threshold);
+    } else {
+        kernel_rule(&w->rule, w->hood, pNeighbor);
+    }
+    w->catchLimit = rng_limit(pCatch);
+}
+
+/// Starts a dense or sparse simulation over from a new cycle 0, placed in
+/// the grid it already has.
+
+int wildfire_reset( Wildfire *w, float density, float pBurning, unsigned long seed ) {
+    if ( w->engine != WILDFIRE_DENSE && w->engine != WILDFIRE_SPARSE ) {
+        return -1;
+    }
+    w->seed = seed;
+    w->counters = (WildfireCounters) { 0 };
+    plant(w, w->grid, density, pBurning);
+    w->counters.spaces = (long)(w->width * w->height) - w->counters.totalTrees;
+    w->counters.initialTrees = w->counters.totalTrees;
+    w->frontStale = 1;
+    w->gridStep = -1;
+    if ( w->summary != NULL ) {
+        summary_destroy(w->summary);
+        w->summary = summary_create(w->grid, 0);
+        if ( w->summary == NULL ) {
+            return -1;
         }
     }
+    return 0;
+}
+
+/// Sets the counters of a simulation continuing a saved run.
+
+void wildfire_restore( Wildfire *w, const WildfireCounters *c ) {
+    if ( w->summary != NULL ) {
+        summary_renumber(w->summary, w->counters.step, c->step);
+    }
+    w->counters = *c;
+    w->frontStale = 1;
+    w->gridStep = -1;
+}
 
+/// Advances the simulation one cycle with the selected engine. The dense
+/// engine updates next from grid and swaps them. The sparse engine steps
+/// grid in place from its front of burning trees, but switches to the dense
+/// update while more than 1/SPARSE_RATIO of the cells are burning, and
+/// rescans the front once the fire has thinned out again. The counted
+/// engine steps grid in place from its neighbor counts. The packed and
+/// tiled engines step their own storage.
+
+int wildfire_step( Wildfire *w ) {
+
+    WildfireCounters *c = &w->counters;
+    c->changes = 0;
+
+    if ( w->engine == WILDFIRE_PACKED || w->engine == WILDFIRE_TILED ) {
+        update(w);
+        if ( w->engine == WILDFIRE_PACKED ) {
+            packed_swap(w->packed);
+        } else {
+            tiled_swap(w->tiled);
+        }
+    } else if ( w->engine == WILDFIRE_COUNTED ) {
+        long ignited;
+        long burnedOut;
+        if ( counted_step(w->counted, w->grid, &w->rule, rng_key(w->seed, c->step),
+                          w->catchLimit, w->summary, &ignited, &burnedOut) != 0 ) {
+            return -1;
+        }
+        tally(w, ignited, burnedOut);
+    } else {
+        int stepped = 0; // 1 once the sparse engine has stepped the cycle
+        if ( w->engine == WILDFIRE_SPARSE ) {
+            long area = (long)( w->width * w->height );
+            if ( w->frontStale && c->fireTrees <= area / SPARSE_RATIO / 2 ) {
+                if ( front_scan(w->front, w->grid) != 0 ) {
+                    return -1;
+                }
+                w->frontStale = 0;
+            } else if ( !w->frontStale && c->fireTrees > area / SPARSE_RATIO ) {
+                w->frontStale = 1;
+            }
+
+            if ( !w->frontStale ) {
+                long ignited;
+                long burnedOut;
+                if ( front_step(w->front, w->grid, &w->rule, rng_key(w->seed, c->step),
+                                w->catchLimit, w->summary, &ignited, &burnedOut) != 0 ) {
+                    return -1;
+                }
+                tally(w, ignited, burnedOut);
+                stepped = 1;
+            }
+        }
 
-    if ( ( row + 1 < tmpsize && col - 1 >= 0 ) ) { // southwest neighbor
-	if ( ( copy[row + 1][col - 1] == 'Y' || copy[row + 1][col - 1] == '*'
-                || copy[row + 1][col - 1] == '0' || copy[row + 1][col - 1] == '1' || copy[row + 1][col - 1] == '2') ) {
-            totalNeighbors++;
+        if ( !stepped ) {
+            update(w);
+            Grid *tmp = w->grid; // the cycle just computed becomes current
+            w->grid = w->next;
+            w->next = tmp;
         }
-        if ( ( copy[row + 1][col - 1] == '*' || copy[row + 1][col + 1] == '0' || copy[row + 1][col - 1] == '1'
-                || copy[row + 1][col - 1] == '2') ) {
-            burningNeighbors++;
+    }
+
+    if ( w->summary != NULL ) {
+        summary_step(w->summary, c->step);
+    }
+    c->cChanges += c->changes;
+    c->step++;
+    return 0;
+}
+
+/// Advances the dense engine k cycles in one pass over the grid, each tile
+/// k cycles at a time, then adds the counts of the bands to the counters
+/// cycle by cycle, exactly as k calls of wildfire_step would have. Once
+/// all fires are out the cycles left change nothing, and are not counted.
+/// @return the number of cycles counted
+
+static long stepBlock( Wildfire *w, int k ) {
+
+    WildfireCounters *c = &w->counters;
+    w->blockCycles = k;
+    stepBands(w);
+    w->blockCycles = 1;
+    Grid *tmp = w->grid; // the last cycle computed becomes current
+    w->grid = w->next;
+    w->next = tmp;
+
+    long stepped = 0;
+    for (int j = 0; j < k && c->fireTrees > 0; j++) {
+        c->changes = 0;
+        for (int t = 0; t < w->threads; t++) {
+            tally(w, w->bands[t].ignitedAt[j], w->bands[t].burnedOutAt[j]);
         }
+        c->cChanges += c->changes;
+        c->step++;
+        stepped++;
     }
+    return stepped;
+}
 
+/// Steps up to n cycles, stopping early once all fires are out. The dense
+/// engine steps blocks of up to timeBlock cycles at once.
 
-    if ( ( row - 1 >= 0 && col - 1 >= 0 ) ) { // northwest neighbor 
-	if ( ( copy[row - 1][col - 1] == 'Y' || copy[row - 1][col - 1] == '*'
-                || copy[row - 1][col - 1] == '0' || copy[row - 1][col - 1] == '1' || copy[row - 1][col - 1] == '2') ) {
-            totalNeighbors++;
+long wildfire_step_n( Wildfire *w, long n ) {
+    long stepped = 0;
+    while ( stepped < n && w->counters.fireTrees > 0 ) {
+        if ( w->timeBlock > 1 && n - stepped > 1 ) {
+            stepped += stepBlock(w, n - stepped < w->timeBlock ? (int)(n - stepped) : w->timeBlock);
+            continue;
         }
-        if ( ( copy[row - 1][col - 1] == '*' || copy[row - 1][col - 1] == '0' || copy[row - 1][col - 1] == '1'
-                || copy[row - 1][col - 1] == '2') ) {
-            burningNeighbors++;
+        if ( wildfire_step(w) != 0 ) {
+            return -1;
         }
+        stepped++;
     }
- 
-    if ( ( (float) burningNeighbors/totalNeighbors ) > pNeighbor ) { // proportion of neighbors is higher
-	float rand = random() / (float) RAND_MAX;
-	if ( rand < pCatch) {
-	    return 1;
-	}
-    }
+    return stepped;
+}
 
-  return 0;   
+/// Reads the counters of a simulation.
 
+void wildfire_query( const Wildfire *w, WildfireCounters *c ) {
+    *c = w->counters;
 }
 
-/// Shuffles grid data to initialize cycle 0
-/// @param size size of grid
-/// @param data array of cells in grid
-/// 
-static void shuffle( long size, char data[]) {
-    for( int i = 0; i < size - 1; ++i) {
-	unsigned long j = (i + random()) % size;
-	char tmp = data[i];
-	data[i] = data[j];
-	data[j] = tmp;
+/// Returns the current cycle as a grid of bytes, copying it out of the
+/// packed or tiled engine, or bringing the burn cycles of the counted
+/// engine up to date, if it was stepped since the last call.
+
+const Grid *wildfire_grid( Wildfire *w ) {
+
+    if ( w->counted != NULL && w->gridStep != w->counters.step ) {
+        counted_sync(w->counted, w->grid);
+        w->gridStep = w->counters.step;
+    }
+    if ( w->packed == NULL && w->tiled == NULL ) {
+        return w->grid;
     }
+    if ( w->grid == NULL ) {
+        w->grid = grid_create(w->width, w->height);
+        if ( w->grid == NULL ) {
+            return NULL;
+        }
+    }
+    if ( w->gridStep != w->counters.step ) {
+        if ( w->packed != NULL ) {
+            packed_unpack(w->packed, w->grid);
+        } else {
+            tiled_unpack(w->tiled, w->grid);
+        }
+        w->gridStep = w->counters.step;
+    }
+    return w->grid;
 }
 
-/// Uses getopt() function to process command line options. 
-/// @param argc length of argv
-/// @param argv array of command strings
-///
+/// Copies cells of one row of the current cycle, out of the packed or
+/// tiled engine, or from grid once the burn cycles of the counted engine
+/// are up to date.
+
+void wildfire_cells( Wildfire *w, size_t r, size_t c, size_t n, cell_t *out ) {
+    if ( w->packed != NULL ) {
+        packed_cells(w->packed, r, c, n, out);
+    } else if ( w->tiled != NULL ) {
+        tiled_cells(w->tiled, r, c, n, out);
+    } else {
+        if ( w->counted != NULL && w->gridStep != w->counters.step ) {
+            counted_sync(w->counted, w->grid);
+            w->gridStep = w->counters.step;
+        }
+        memcpy(out, grid_row(w->grid, r) + c, n);
+    }
+}
 
-int main( int argc, char * argv[] ) {
+/// Counts the trees of a rectangle of the current cycle, from the summary
+/// if the rectangle covers whole tiles of it, or else cell by cell.
 
-    int seed = 41;
-    srandom(seed); // seeds random number generator 
+void wildfire_tally( Wildfire *w, size_t r0, size_t c0, size_t rows, size_t cols,
+                     SummaryCounts *out ) {
 
-    int c;
-    int opterr = 0; 
+    // tiles at the edges of the grid may be short
+    int tiled = r0 % SUMMARY_TILE == 0 && c0 % SUMMARY_TILE == 0
+        && ( rows % SUMMARY_TILE == 0 || r0 + rows >= w->height )
+        && ( cols % SUMMARY_TILE == 0 || c0 + cols >= w->width );
+    if ( w->summary != NULL && tiled ) {
+        summary_tally(w->summary, r0, c0, rows, cols, out);
+        return;
+    }
+    *out = (SummaryCounts) { 0, 0, 0, 0 };
+    cell_t cells[256]; // a piece of a row at a time
+    for (size_t r = r0; r < r0 + rows; r++) {
+        for (size_t c = c0; c < c0 + cols; c += sizeof cells) {
+            size_t n = c0 + cols - c < sizeof cells ? c0 + cols - c : sizeof cells;
+            wildfire_cells(w, r, c, n, cells);
+            for (size_t j = 0; j < n; j++) {
+                out->living += cells[j] == CELL_LIVING;
+                out->burning += (cells[j] & CELL_FIRE) != 0;
+                out->burnt += cells[j] == CELL_BURNT;
+            }
+        }
+    }
+    out->cells = (uint64_t) rows * cols;
+}
 
-// // // // // // // // // // // // // // // // // // // // // // // // 
-// 
-// If -H, -b, -c, -d, -n, -p or -s are on the command line, getopt will
-// process those arguments. All options except the -H option expect an 
-// argument. 
-//
-// // // // // // // // // // // // // // // // // // // // // // // // 
-
-    while ( (c = getopt( argc, argv, "Hb:c:d:n:p:s:") ) != -1 ) { 
-
-    switch ( c ) {
-    case 'H':
-        help();
-	break;
-
-    case 'b':
-	opterr = (int)strtol( optarg, NULL, 10);
-	if ( 0 < opterr && opterr < 101) {
-	    pBurning = (float)opterr/100;
-	} else {
-	    fprintf( stderr, "(-bN) proportion already burning. must be an integer in [1...100].\n");
-	    help();
-	}
-	break;
-
-    case 'c':
-	opterr = (int)strtol( optarg, NULL, 10);
-	if (0 <  opterr && opterr < 101) {
-	    pCatch = (float)opterr/100;
-	} else {
-	    fprintf( stderr, "(-cN) probability a tree will catch fire. must be an integer in [1...100].\n");
-	    help();
-	}
-	break;
-
-    case 'd':
-	opterr = (int)strtol( optarg, NULL, 10);
-	if (0 < opterr && opterr < 101) {
-	    density = (float)opterr/100;
-	} else {
-	    fprintf( stderr, "(-dN) density of trees in the grid must be an integer in [1...100].\n");
-	    help();
-	}
-	break;
-
-    case 'n':
-	opterr = (int)strtol( optarg, NULL, 10);
-	if (-1 < opterr && opterr < 101) {
-	    pNeighbor = (float)opterr/100;
-	} else {
-	    fprintf( stderr, "(-nN) neighbors influence catching fire must be an integer in [0...100].\n");
-	    help();
-	}
-	break;
-
-    case 'p':
-	opterr = (int)strtol( optarg, NULL, 10);
-	if (-1 < opterr) {
-	    print = 1;
-	    cycle = (int)opterr;
-	} else {
-	    fprintf( stderr, "(-pN) number of cycles to print. must be an integer in [0...10000].\n");
-	    help();
-	}
-	break;
-
-    case 's':
-	opterr = (int)strtol( optarg, NULL, 10);
-	if (4 < opterr && opterr < 41) {
-	    size = (size_t)opterr;
-	} else {
-	    fprintf( stderr, "(-sN) simulation grid size must be an integer in [5...40].\n");
-	    help();
-	}
-	break;
-
-    default: 
-	fprintf( stderr, "Bad option causes failure. \n");
-	break;
-    }
-
-
-  }
-
-	// gets cells
-
-	float x = (size * size) * density;
-	totalTrees = (int)(x + 0.5); // rounds float to integer  
-	float y = totalTrees * pBurning; // represented by (*) 
-	fireTrees = (int)(y + 0.5);
-	float z = (totalTrees - fireTrees); // represented by (Y)
-	livingTrees = (int)(z + 0.5);
-	float s = (size * size) - totalTrees; // represented by space character
-	spaces = (int)(s + 0.5);
-
-	size_t spots = spaces + livingTrees + fireTrees;
-	char start[spots];
-
-	memset(start, 0, spots);
-
-	int d;
-	int e;
-	int f;
-
-	size_t len;
-
-	for (d = 0; d < spaces; d++) {
-	    len = strlen(start);
-	    start[len] = ' ';
-	    start[len + 1] = '\0';
-	}
-
-	for (e = 0; e < livingTrees; e++) {
-	    len = strlen(start);
-            start[len] = 'Y';
-            start[len + 1] = '\0';
-	}
-
-	for (f = 0; f < fireTrees; f++) {
-	    len = strlen(start);
-            start[len] = '*';
-            start[len + 1] = '\0';
-	}
-
-	shuffle(spots, start);
-
-	//  
-
-	char grid [size][size]; // grid is represented as a 2D array
-
-	int i;
-	int j;
-	int k = 0;
-	
-	if (print == 0) {
-	clear(); 
-	}
-
-	if (print == 1) {
-	    printf("%s\n", "============================");
-  	    printf("%s\n", "======== Wildfire ==========");
-  	    printf("%s\n", "============================");
-            printf("==== Print <=  %d Cycles ====\n", cycle);
-            printf("%s\n", "============================");
-	}
-
-	for (i = 0; i < size; i++) {
-	    for (j = 0; j < size; j++) {
-	        grid[i][j] = start[k];
-		if (print == 0) {
-		    set_cur_pos(i, j);
-		    put(grid[i][j]);
-		} else {
-		printf("%c", grid[i][j]);
-		}
-		k++;
-	    }
-	  printf("\n");
-	}
-
-	printf("\rsize %zu, pCatch %.2f, density %.2f, pBurning %.2f, pNeighbor %.2f", size, pCatch, density, pBurning, pNeighbor);
-        printf("\ncycle %d, changes %d, cumulative changes %d\n ", 0, 0, 0);
-	usleep(750000);
-
-// // // // // // // // // // // // // // // // // // // // // // // // 
-// 
-// The Simulation Loop:
-// The loop continually applies the update algorithm and checks if
-// all fires are out or the number of cycles has been reached. 
-//
-// // // // // // // // // // // // // // // // // // // // // // // // 
-
-    int currCycle = 1; // current cycle of simulation 	
-
-    while(fireTrees > 0 && cycle > 0) {
-	update(grid);
-	cChanges += changes;
-
-	for (i = 0; i < size; i++) { 
-            for (j = 0; j < size; j++) {
-		if ( grid[i][j] == '0' || grid[i][j] == '1' || grid[i][j] == '2' ) {
-		    if ( print == 0) {
-		        set_cur_pos(i, j);
-			put('*');
-		    } else {
-		    printf("%c", '*');
-		    }
-		} else {
-		    if ( print == 0) {
-		        set_cur_pos(i, j);
-			put(grid[i][j]);
-		    } else {
-		printf("%c", grid[i][j]);
-		}
-	      }
-	    }
-	    if( print == 1 && i != (size - 1)) {
-	        printf("\n");
-	    }
-	}
-	puts(" ");
-	printf("\rsize %zu, pCatch %.2f, density %.2f, pBurning %.2f, pNeighbor %.2f", size, pCatch, density, pBurning, pNeighbor);
-        printf("\ncycle %d, changes %d, cumulative changes %d \n", currCycle, changes, cChanges);	
-	changes = 0;
-	currCycle++;
-	cycle--;
-	usleep(750000);
-    }
-      if ( fireTrees == 0) {
-          printf("%s\n", "Fires are out.");
-    }
-
-return(EXIT_SUCCESS);
+/// Stops the threads of a simulation and releases it.
 
+void wildfire_destroy( Wildfire *w ) {
+    if ( w == NULL ) {
+        return;
+    }
+    stopBands(w);
+    grid_destroy(w->grid);
+    grid_destroy(w->next);
+    front_destroy(w->front);
+    packed_destroy(w->packed);
+    tiled_destroy(w->tiled);
+    counted_destroy(w->counted);
+    summary_destroy(w->summary);
+    free(w);
 }
@@ -6,56 +6,214 @@
  * Date: 8 July 2017
  *
  * Description:
- *      Implements the simulation of spreading fire. The program implements
- * a combination of [Shiflet] Assignents with variations. The state of 
- * the system is repeatedly computed and displayed to show the progression
- * of a forest fire. Each state represents the start of a new cycle. The simulation
- * is represented by a grid of cells. Cursor-control functions are used to show changes
- * to the grid as the fire spreads. The optional print mode prints another grid for
- * each simulation cycle.
+ *      The simulation of spreading fire as a library. All the state of a
+ * simulation, its grids, parameters, counters and the threads stepping
+ * it, is held by a Wildfire context, so any number of simulations can
+ * run in one process and be stepped by the caller whenever it likes:
+ *
+ *      WildfireConfig cfg;
+ *      wildfire_defaults( &cfg );
+ *      cfg.width = cfg.height = 1000;
+ *      Wildfire *w = wildfire_create( &cfg );
+ *      wildfire_step_n( w, 100 );
+ *      wildfire_query( w, &counters );
+ *      wildfire_destroy( w );
+ *
+ *      A simulation only touches its own context, and the rest of the
+ * program only through the row kernels, which are pure. Different
+ * simulations may be stepped from different threads at once; one
+ * simulation must be called from one thread at a time.
+ *      The command line program (main.c) is one user of this interface.
  *
  */
 
- #ifndef wildfire
- #define wildfire
+#ifndef WILDFIRE_H
+#define WILDFIRE_H
+
+#include <stddef.h>
+
+#include "grid.h"
+#include "kernel.h"
+#include "summary.h"
+
+#define WILDFIRE_TIME_BLOCK_MAX 32 ///< most cycles a tile may be advanced at once
+
+/// How each cycle is stepped. All engines compute the same cycles, cell
+/// for cell; they differ in speed and memory.
+///
+typedef enum {
+    WILDFIRE_DENSE,  ///< every cell is stepped every cycle
+    WILDFIRE_SPARSE, ///< only burning trees and their neighbors (see sparse.h)
+    WILDFIRE_PACKED, ///< four bits per cell, a word at a time (see packed.h)
+    WILDFIRE_TILED,  ///< tiles, skipping the quiescent ones (see tiled.h)
+    WILDFIRE_COUNTED ///< neighbor counts changed only where trees change
+                     ///< (see counted.h); one thread
+} WildfireEngine;
+
+/// What a simulation runs.
+///
+typedef struct {
+    size_t width;              ///< number of columns in the grid
+    size_t height;             ///< number of rows in the grid
+    float pCatch;              ///< probability of a tree catching fire
+    float density;             ///< proportion of cells holding a tree at cycle 0
+    float pBurning;            ///< proportion of trees burning at cycle 0
+    float pNeighbor;           ///< proportion of burning neighbors needed to spread
+    unsigned long seed;        ///< seed of the random number streams
+    WildfireEngine engine;     ///< how each cycle is stepped
+    int threads;               ///< threads stepping the grid, at least 1
+    RowKernel kernel;          ///< row kernel; NULL for the fastest supported
+    Neighborhood neighborhood; ///< cells whose burning trees spread fire;
+                               ///< the sparse and packed engines take Moore only
+    int threshold;             ///< burning neighbors that spread fire, or 0 to
+                               ///< spread by pNeighbor
+    int timeBlock;             ///< most cycles the dense engine advances a tile
+                               ///< at once in wildfire_step_n, up to
+                               ///< WILDFIRE_TIME_BLOCK_MAX; 1 for none
+    int summary;               ///< 1 to keep tree counts per tile while stepping,
+                               ///< for wildfire_tally; no temporal blocking then
+    Grid *landscape;           ///< cycle 0, of width by height cells, taken over by
+                               ///< the simulation; NULL to place trees at random
+                               ///< from density and pBurning
+} WildfireConfig;
+
+/// The counters of a simulation.
+///
+typedef struct {
+    long step;         ///< cycles stepped since cycle 0
+    long changes;      ///< cells changed by the last cycle stepped
+    long cChanges;     ///< cells changed by all cycles stepped
+    long totalTrees;   ///< trees not burned out
+    long fireTrees;    ///< burning trees
+    long livingTrees;  ///< living trees
+    long spaces;       ///< cells without a tree at cycle 0
+    long initialTrees; ///< trees at cycle 0
+} WildfireCounters;
+
+/// Opaque simulation context.
+///
+typedef struct Wildfire Wildfire;
+
+/// Fills a configuration with the defaults of the command line program.
+///
+/// @param cfg: receives the defaults
+///
+void wildfire_defaults( WildfireConfig *cfg );
 
-/// Help function gives instructions. Prints usage information to stderr.
-/// Terminates program when finished. 
-/// 
-static void help();
+/// Creates a simulation at cycle 0 and starts the threads stepping it.
+/// The configuration is copied and may be reused; its landscape, if
+/// any, belongs to the simulation from then on, even if creation fails.
+///
+/// @param cfg: what to run
+/// @return the simulation, or NULL if memory or threads could not be
+///         obtained, the landscape does not have the configured size, or
+///         the engine does not step the neighborhood
+///
+Wildfire *wildfire_create( const WildfireConfig *cfg );
 
-/// Modifies the grid in place. Applies spread function to 
-/// each cell.
-/// Changes any burning tree to a 0,1,2 or 3 to represent
-/// its current cycle. These numbers are ignored when the grid
-/// is printed. The function handles the 2-cycle burn for trees that burn. 
+/// Changes the spread parameters of a simulation, from the next cycle on.
+/// A simulation with a threshold rule keeps it and ignores pNeighbor.
 ///
-/// @param g: grid to be updated
+/// @param w: the simulation
+/// @param pCatch: probability of a tree catching fire
+/// @param pNeighbor: proportion of burning neighbors needed to spread
 ///
-static void update( char g[size][size] );
+void wildfire_configure( Wildfire *w, float pCatch, float pNeighbor );
 
-/// Implements the spread algorithm. Function handles 8-way connectivity of neighbors.
-/// The 2-cycle burn for burning trees is handled in update.
+/// Starts a simulation over from a new cycle 0 placed at random, as
+/// wildfire_create would with these values, in the grids it already has.
+/// Only the dense and sparse engines, which step a byte grid, are reset;
+/// the rest of the configuration is kept.
 ///
-/// @param row: the destination row
-/// @param col: the destination column
-/// @param copy: copy of grid that doesn't change
-/// 
-static int applySpread(int row, int col, char copy[size][size]);
+/// @param w: the simulation
+/// @param density: proportion of cells holding a tree
+/// @param pBurning: proportion of trees burning
+/// @param seed: seed of the random number streams
+/// @return 0 on success, -1 for another engine or if the summary could
+///         not be made again, after which the simulation cannot go on
+///
+int wildfire_reset( Wildfire *w, float density, float pBurning, unsigned long seed );
 
-/// Shuffles grid data to initialize cycle 0. Taken from lecture. 
+/// Sets the counters of a simulation whose landscape is a cycle saved
+/// from an earlier run (see checkpoint.h). The step selects the random
+/// numbers of the next cycle, so the run continues exactly as the saved
+/// one would have.
+///
+/// @param w: the simulation
+/// @param c: the counters of the saved run
 ///
-/// @param size: size of data
-/// @param data: 1d array of empty, tree, and burning characters
-/// 
-static void shuffle( long size, char data[]);
+void wildfire_restore( Wildfire *w, const WildfireCounters *c );
 
-/// Uses getopt() function to process command line options. Runs the simulation until
-/// all fires are out or max number of cycles is reached.
+/// Steps one cycle.
+///
+/// @param w: the simulation
+/// @return 0 on success, -1 if the sparse or counted engine ran out of
+///         memory, after which the simulation cannot go on
+///
+int wildfire_step( Wildfire *w );
+
+/// Steps up to n cycles, stopping early once all fires are out. With a
+/// timeBlock above 1, the dense engine advances the grid that many cycles
+/// per pass, each tile with a margin wide enough to compute them all
+/// while it is in cache; the cycles and counters are the same as n calls
+/// of wildfire_step.
+///
+/// @param w: the simulation
+/// @param n: most cycles to step
+/// @return cycles stepped, or -1 as wildfire_step
+///
+long wildfire_step_n( Wildfire *w, long n );
+
+/// Reads the counters of a simulation.
+///
+/// @param w: the simulation
+/// @param c: receives the counters
+///
+void wildfire_query( const Wildfire *w, WildfireCounters *c );
+
+/// Returns the current cycle as a grid of bytes (see grid.h). The packed
+/// and tiled engines keep their cells in their own storage and copy
+/// them into a grid of the simulation on the first call after a step;
+/// the counted engine writes the burn cycles of its burning trees then.
+///
+/// @param w: the simulation
+/// @return the current cycle, valid until the next step, or NULL if
+///         memory for the copy could not be obtained
+///
+const Grid *wildfire_grid( Wildfire *w );
+
+/// Copies cells of one row of the current cycle straight from the storage
+/// of the engine. Unlike wildfire_grid, it costs the cells copied and not
+/// the grid, whatever the engine.
+///
+/// @param w: the simulation
+/// @param r: the row
+/// @param c: first column
+/// @param n: number of cells, all in the grid
+/// @param out: receives the cells
+///
+void wildfire_cells( Wildfire *w, size_t r, size_t c, size_t n, cell_t *out );
+
+/// Counts the trees of a rectangle of the current cycle. With a summary
+/// (see summary.h) a rectangle on tile boundaries, whose sides are whole
+/// SUMMARY_TILE cells or end at the edge of the grid, costs about as many
+/// tiles as its edges cross, whatever its size; otherwise its cells are
+/// counted one by one.
+///
+/// @param w: the simulation
+/// @param r0: first row
+/// @param c0: first column
+/// @param rows: rows of the rectangle
+/// @param cols: columns of the rectangle
+/// @param out: receives the counts
+///
+void wildfire_tally( Wildfire *w, size_t r0, size_t c0, size_t rows, size_t cols,
+                     SummaryCounts *out );
+
+/// Stops the threads of a simulation and releases it. NULL is ignored.
+///
+/// @param w: the simulation
 ///
-/// @param size: size of data
-/// @param data: 1d array of empty, tree, and burning characters
-/// 
-int main( int argc, char * argv[] );
+void wildfire_destroy( Wildfire *w );
 
 #endif